@@ -0,0 +1,33 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <map>
+#include <cstddef>
+#include <utility>
+#include <memory_resource>
+
+// a graph's edges: {v1, v2} -> weight
+using edge_set = std::pmr::map<std::pair<int, int>, int>;
+// vertex label -> matrix index
+using vertex_map = std::pmr::map<int, size_t>;
+
+// the memory of one run, for programs that solve many small graphs. pass it
+// to csg::parse and as path_options::memory, and the edge set, vertex maps,
+// matrices and the engine's working copies are all carved out of a few large
+// blocks, freed at once when the arena goes, rather than thousands of map
+// nodes and vectors each freed on its own.
+//
+// what is made in an arena must be gone before it is, so declare the arena
+// before them. blocks beyond the first come from the default resource at the
+// arena's construction. like any monotonic_buffer_resource it is for one
+// thread at a time.
+class run_arena : public std::pmr::monotonic_buffer_resource {
+public:
+    run_arena() : monotonic_buffer_resource(_initial, sizeof(_initial)) {}
+
+private:
+    // enough for a graph of a few dozen vertices before touching the heap
+    std::byte _initial[64 << 10];
+};
+
+#endif
@@ -0,0 +1,297 @@
+#ifdef BENCHMARK
+
+#include "csg.hpp"
+#include "matrix.hpp"
+#include "paths.hpp"
+#include "tcolor.hpp"
+#include "gen.hpp"
+#include "scheduler.hpp"
+#include "hugepage.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <chrono>
+#include <charconv>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <getopt.h>
+
+using std::map, std::pair;
+using std::string;
+
+using edges_t = edge_set;
+
+namespace {
+
+struct family {
+    const char* name;
+    gen::generator (*make)(int);
+};
+
+// n is roughly the order of the graph; the grid is the nearest square.
+constexpr family families[] = {
+    {"cycle", [](int n) { return gen::cycle(n); }},
+    {"barbell", [](int n) { return gen::barbell(n); }},
+    {"random", [](int n) { return gen::random(n, 2.0 / n, 0.5, n); }},
+    {"grid",
+     [](int n) {
+         int w = std::max(2, int(std::lround(std::sqrt(n))));
+         return gen::grid(w, w);
+     }},
+};
+
+string to_csg(const gen::generator& g)
+{
+    std::ostringstream out;
+    gen::write(out, g);
+    return out.str();
+}
+
+// discards everything written to it
+struct null_buf : std::streambuf {
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override
+    {
+        return n;
+    }
+};
+
+// times `reps` calls of fn in nanoseconds, sorted.
+std::vector<double> measure(int reps, const std::function<void()>& fn)
+{
+    std::vector<double> ns;
+    for (int i = 0; i < reps; ++i) {
+        auto t0 = std::chrono::steady_clock::now();
+        fn();
+        auto t1 = std::chrono::steady_clock::now();
+        ns.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+    }
+    std::ranges::sort(ns);
+    return ns;
+}
+
+// nearest-rank percentile of sorted samples
+double percentile(const std::vector<double>& sorted, double p)
+{
+    size_t rank = std::max<size_t>(1, size_t(p * sorted.size() + 0.999999));
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+void report(const char* fam, int n, const char* stage,
+            const std::vector<double>& ns, double units)
+{
+    double med = percentile(ns, 0.5);
+    std::printf("%-8s %5d  %-12s %14.0f %14.0f", fam, n, stage, med,
+                percentile(ns, 0.99));
+    if (units > 0) {
+        std::printf(" %10.3f", med / units);
+    }
+    std::printf("\n");
+}
+
+// change signals per task and sweeps per measurement in the signalling
+// benchmark
+constexpr int signals = 1024;
+constexpr int sweeps = 64;
+
+// times sweeps of 4 tasks per thread, each task signalling a change
+// `signals` times: through an epoch_counter, or through one shared atomic
+// every worker writes.
+void bench_signals(int maxthreads, int reps)
+{
+    for (unsigned t = 1; t <= unsigned(maxthreads); t *= 2) {
+        steal_pool pool(t);
+        epoch_counter counter(t);
+        std::atomic<uint64_t> shared{0};
+        uint64_t epoch = 0;
+
+        report("signal", t, "epoch", measure(reps, [&] {
+                   for (int s = 0; s < sweeps; ++s) {
+                       ++epoch;
+                       pool.run(4 * t, [&](size_t, unsigned worker) {
+                           for (int i = 0; i < signals; ++i) {
+                               counter.add(worker, epoch, 1);
+                           }
+                       });
+                       if (counter.total(epoch) != 4 * t * signals) {
+                           throw std::logic_error("lost a signal");
+                       }
+                   }
+               }),
+               sweeps);
+        report("signal", t, "shared", measure(reps, [&] {
+                   for (int s = 0; s < sweeps; ++s) {
+                       shared = 0;
+                       pool.run(4 * t, [&](size_t, unsigned) {
+                           for (int i = 0; i < signals; ++i) {
+                               shared.fetch_add(1, std::memory_order_relaxed);
+                           }
+                       });
+                   }
+               }),
+               sweeps);
+    }
+}
+
+// backs every buffer allocated from here on according to `mode`, as lab5.out
+// does. the resource is static, so it outlives every matrix made from it
+// and is still the default when the program's statics are destroyed.
+void use_hugepages(hugepage_mode mode)
+{
+    static std::optional<hugepage_resource> resource;
+    if (mode == hugepage_mode::off || resource) {
+        return;
+    }
+    resource.emplace(mode);
+    std::pmr::set_default_resource(&*resource);
+}
+
+// parses the value of option `-opt`, which must be a whole number >= 1.
+int parse_option(char opt, const char* arg)
+{
+    int n = 0;
+    std::string_view s(arg);
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), n);
+    if (ec != std::errc() || ptr != s.data() + s.size() || n < 1) {
+        throw std::runtime_error("invalid value '" + string(s) + "' for -" +
+                                 opt);
+    }
+    return n;
+}
+
+string usage()
+{
+    string use(BOLD "usage:\n" RESET);
+    use += "\tlab5bench.out [-n max] [-r reps] [-e engine] [-j n] [-t max]\n"
+           "\t              [-H mode]\n\n";
+    use += "\t-n max    largest graph order to run (default 32)\n";
+    use += "\t-r reps   repetitions per measurement (default 5)\n";
+    use += "\t-e name   path engine to time (default reference)\n";
+    use += "\t-j n      threads for the parallel engine (default 1)\n";
+    use += "\t-t max    most threads for the signalling benchmark (default "
+           "64)\n";
+    use += "\t-H mode   huge pages for matrices, experimental: off "
+           "(default),\n"
+           "\t          thp or explicit\n";
+    return use;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+try {
+    int maxn = 32;
+    int reps = 5;
+    int maxthreads = 64;
+    path_options popts;
+    hugepage_mode hugepages = hugepage_mode::off;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:e:j:t:H:")) != -1) {
+        switch (opt) {
+        case 'n':
+            maxn = parse_option('n', optarg);
+            break;
+        case 'r':
+            reps = parse_option('r', optarg);
+            break;
+        case 'e':
+            popts.engine = parse_engine(optarg);
+            break;
+        case 'j':
+            popts.nthreads = parse_option('j', optarg);
+            break;
+        case 't':
+            maxthreads = parse_option('t', optarg);
+            break;
+        case 'H':
+            hugepages = parse_hugepages(optarg);
+            break;
+        default:
+            throw std::runtime_error("invalid arguments");
+        }
+    }
+
+    use_hugepages(hugepages);
+
+    null_buf nbuf;
+    std::ostream sink(&nbuf);
+
+    std::printf("%-8s %5s  %-12s %14s %14s %10s\n", "family", "n", "stage",
+                "median ns", "p99 ns", "ns/update");
+    for (const auto& fam : families) {
+        for (int n : {8, 12, 16, 24, 32, 48, 64, 128, 256, 512}) {
+            if (n > maxn) {
+                break;
+            }
+            auto g = fam.make(n);
+            edges_t edges = gen::collect(g);
+            string text = to_csg(g);
+            adjmat mat(edges);
+            size_t dim = mat.dim();
+            adjmat result;
+
+            edges_t parsed;
+            report(fam.name, n, "parse",
+                   measure(reps,
+                           [&] {
+                               std::istringstream in(text);
+                               parsed = csg::parse(in);
+                           }),
+                   0);
+            report(fam.name, n, "adjmat",
+                   measure(reps, [&] { mat = adjmat(edges); }),
+                   0);
+
+            // every reference sweep visits every (i, j, k) once. other engines
+            // are measured against the same count, so ns/update compares
+            // them directly.
+            double updates = double(3 * dim * dim - 1) * dim * dim * dim;
+            report(fam.name, n, "exact0paths",
+                   measure(reps, [&] { result = exact0paths(mat, popts); }),
+                   updates);
+            report(fam.name, n, "operator<<",
+                   measure(reps, [&] { sink << result; }),
+                   0);
+
+            // a batch job's whole run on one small graph, allocating from
+            // the heap and then from a run_arena.
+            if (n > 64) {
+                continue;
+            }
+            report(fam.name, n, "run",
+                   measure(reps,
+                           [&] {
+                               std::istringstream in(text);
+                               exact0paths(csg::parse(in), popts);
+                           }),
+                   0);
+            path_options in_arena = popts;
+            report(fam.name, n, "run arena",
+                   measure(reps,
+                           [&] {
+                               run_arena arena;
+                               in_arena.memory = &arena;
+                               std::istringstream in(text);
+                               exact0paths(csg::parse(in, &arena), in_arena);
+                           }),
+                   0);
+        }
+    }
+    bench_signals(maxthreads, reps);
+    return 0;
+}
+catch (const std::exception& e) {
+    std::cerr << RED BOLD "error: " RESET << e.what() << "\n\n" << usage();
+    return 1;
+}
+
+#endif
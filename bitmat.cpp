@@ -0,0 +1,144 @@
+#include "bitmat.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+bitmat::bitmat(const adjmat& mat, int val) : bitmat(mat.dim())
+{
+    for (auto r = 0u; r < _dim; ++r) {
+        const int* cells = mat.row(r);
+        for (auto c = 0u; c < _dim; ++c) {
+            if (cells[c] == val) {
+                set(r, c);
+            }
+        }
+    }
+}
+
+size_t bitmat::count() const
+{
+    size_t n = 0;
+    for (uint64_t w : _bits) {
+        n += std::popcount(w);
+    }
+    return n;
+}
+
+void bitmat::store(adjmat& mat, int val) const
+{
+    for (auto r = 0u; r < _dim; ++r) {
+        for (auto c = 0u; c < _dim; ++c) {
+            if (test(r, c)) {
+                mat(r, c) = val;
+            }
+        }
+    }
+}
+
+// bits of a row handled per table
+static constexpr size_t group = 8;
+
+bool mul_or(bitmat& out, const bitmat& a, const bitmat& b)
+{
+    size_t n = a.dim();
+    if (b.dim() != n || out.dim() != n) {
+        throw std::logic_error("bitmat dimension mismatch");
+    }
+    size_t words = a.words();
+    uint64_t changed = 0;
+
+    // table[m] is the union of the rows of b picked out by the bits of m.
+    std::vector<uint64_t> table((1 << group) * words);
+    // b's rows are copied in first so an aliased `out` can't change them
+    // while the table is built.
+    std::vector<uint64_t> rows(group * words);
+
+    for (size_t k0 = 0; k0 < n; k0 += group) {
+        size_t kn = std::min(group, n - k0);
+        for (size_t i = 0; i < kn; ++i) {
+            std::copy_n(b.row(k0 + i), words, rows.data() + i * words);
+        }
+        std::fill_n(table.data(), words, 0);
+        for (size_t m = 1; m < (size_t(1) << kn); ++m) {
+            // m is m's lowest bit plus a smaller, already built entry
+            const uint64_t* prev = table.data() + (m & (m - 1)) * words;
+            const uint64_t* add = rows.data() + std::countr_zero(m) * words;
+            uint64_t* dst = table.data() + m * words;
+            for (size_t w = 0; w < words; ++w) {
+                dst[w] = prev[w] | add[w];
+            }
+        }
+
+        // k0 is a multiple of 8, so the group's bits sit in a single byte.
+        size_t word = k0 / 64;
+        size_t shift = k0 % 64;
+        for (size_t i = 0; i < n; ++i) {
+            size_t m = (a.row(i)[word] >> shift) & 0xff;
+            if (m == 0) {
+                continue;
+            }
+            const uint64_t* src = table.data() + m * words;
+            uint64_t* dst = out.row(i);
+            for (size_t w = 0; w < words; ++w) {
+                changed |= src[w] & ~dst[w];
+                dst[w] |= src[w];
+            }
+        }
+    }
+    return changed != 0;
+}
+
+#ifdef TESTING
+#include "doctest.h"
+
+#include <random>
+
+TEST_CASE("bitmat")
+{
+    SUBCASE("bitmat(adjmat, val)")
+    {
+        adjmat m{{-1, 1, 2}, {2, 0, 1}, {1, 2, -1}};
+        bitmat pos(m, 1);
+        CHECK(pos.count() == 3);
+        CHECK(pos.test(0, 1));
+        CHECK(pos.test(1, 2));
+        CHECK(pos.test(2, 0));
+        CHECK_FALSE(pos.test(0, 0));
+
+        adjmat blank(3, 2);
+        pos.store(blank, 1);
+        CHECK(bitmat(blank, 1) == pos);
+    }
+
+    SUBCASE("mul_or")
+    {
+        std::mt19937 rng(5);
+        for (size_t n : {1, 7, 64, 70, 131}) {
+            bitmat a(n), b(n), out(n);
+            for (size_t i = 0; i < n * n / 8 + 1; ++i) {
+                a.set(rng() % n, rng() % n);
+                b.set(rng() % n, rng() % n);
+            }
+            out.set(0, 0);
+            bitmat expect = out;
+            for (size_t i = 0; i < n; ++i) {
+                for (size_t k = 0; k < n; ++k) {
+                    if (!a.test(i, k)) {
+                        continue;
+                    }
+                    for (size_t j = 0; j < n; ++j) {
+                        if (b.test(k, j)) {
+                            expect.set(i, j);
+                        }
+                    }
+                }
+            }
+            CHECK(mul_or(out, a, b) == (expect.count() != 1));
+            CHECK(out == expect);
+            CHECK_FALSE(mul_or(out, a, b));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef BITMAT_HPP
+#define BITMAT_HPP
+
+#include "matrix.hpp"
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+// std::allocator, except that elements made without a value are left
+// uninitialized. a large buffer then has none of its pages touched, and so
+// placed on a NUMA node, until something first writes them.
+template <typename T>
+struct untouched_allocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        using other = untouched_allocator<U>;
+    };
+
+    untouched_allocator() = default;
+    template <typename U>
+    untouched_allocator(const untouched_allocator<U>&)
+    {
+    }
+
+    template <typename U>
+    void construct(U* p)
+    {
+        ::new (static_cast<void*>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args)
+    {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+// square boolean matrix, one bit per cell, rows packed into 64-bit words.
+//
+// the path engines treat D[-1], D[0] and D[1] as relations: a cell of D[w] is
+// set when there is a path of weight w. bitmat holds one such relation.
+class bitmat {
+public:
+    bitmat() : _dim{0}, _words{0} {};
+    explicit bitmat(size_t dim)
+        : _dim{dim}, _words{(dim + 63) / 64}, _bits(_dim * _words, 0){};
+
+    // a bitmat whose rows hold garbage until written, so that whichever
+    // thread writes a row first decides where its pages live.
+    struct untouched_t {};
+    static constexpr untouched_t untouched{};
+    bitmat(size_t dim, untouched_t)
+        : _dim{dim}, _words{(dim + 63) / 64}, _bits(_dim * _words){};
+
+    // the cells of `mat` equal to `val`
+    bitmat(const adjmat& mat, int val);
+
+    size_t dim() const { return _dim; }
+    // words per row
+    size_t words() const { return _words; }
+
+    uint64_t* row(size_t r) { return _bits.data() + r * _words; }
+    const uint64_t* row(size_t r) const { return _bits.data() + r * _words; }
+
+    bool test(size_t r, size_t c) const
+    {
+        return row(r)[c / 64] >> (c % 64) & 1;
+    }
+    void set(size_t r, size_t c) { row(r)[c / 64] |= uint64_t(1) << (c % 64); }
+
+    // number of set cells
+    size_t count() const;
+
+    // sets the cells of `mat` that are set here to `val`
+    void store(adjmat& mat, int val) const;
+
+    friend bool operator==(const bitmat&, const bitmat&) = default;
+
+private:
+    size_t _dim;
+    size_t _words;
+    std::vector<uint64_t, untouched_allocator<uint64_t>> _bits;
+};
+
+// out |= a·b over the boolean semiring, by the method of Four Russians: the
+// rows of b are taken eight at a time and all 256 of their unions tabulated,
+// so each row of the product costs one table lookup per byte of a's row
+// instead of one row union per set bit. O(n³ / (64·8)) word operations.
+//
+// `out` may alias `a` or `b`; the bits it gains part way through are simply
+// used early. returns whether `out` changed.
+bool mul_or(bitmat& out, const bitmat& a, const bitmat& b);
+
+#endif
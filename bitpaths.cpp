@@ -0,0 +1,521 @@
+#include "bitpaths.hpp"
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <utility>
+
+using clock_type = std::chrono::steady_clock;
+
+// reports a sweep of a boolean engine through opts.on_sweep. `before` holds
+// the cell counts of neg, zero and pos when the sweep started and is
+// updated to the current counts. `updates` is the (i, j, k) triples the
+// sweep covered.
+static void report(const path_options& opts, int64_t sweep, size_t before[3],
+                   const bitmat& neg, const bitmat& zero, const bitmat& pos,
+                   clock_type::time_point begin, clock_type::time_point swept,
+                   double updates, std::vector<double> utilization = {})
+{
+    if (!opts.on_sweep) {
+        return;
+    }
+    size_t n = zero.dim();
+    size_t after[3] = {neg.count(), zero.count(), pos.count()};
+    auto now = clock_type::now();
+    std::chrono::duration<double> took = now - swept;
+
+    sweep_stats stats{sweep, 3 * int64_t(n * n) - 1};
+    for (int m = 0; m < 3; ++m) {
+        stats.changed[m] = after[m] - before[m];
+        before[m] = after[m];
+    }
+    stats.elapsed = now - begin;
+    stats.updates_per_sec = updates / std::max(took.count(), 1e-9);
+    stats.utilization = std::move(utilization);
+    opts.on_sweep(stats);
+}
+
+void closure_fourrussians(bitmat& neg, bitmat& zero, bitmat& pos,
+                          const path_options& opts)
+{
+    auto begin = clock_type::now();
+    size_t n = zero.dim();
+    size_t counts[3] = {neg.count(), zero.count(), pos.count()};
+
+    bool changed = true;
+    for (int64_t sweep = 1; changed; ++sweep) {
+        auto swept = clock_type::now();
+        // in place, like the reference: later products see this sweep's
+        // earlier results.
+        changed = mul_or(zero, neg, pos);
+        changed |= mul_or(zero, pos, neg);
+        changed |= mul_or(pos, pos, zero);
+        changed |= mul_or(pos, zero, pos);
+        changed |= mul_or(neg, neg, zero);
+        changed |= mul_or(neg, zero, neg);
+        // the products cover every (i, j, k), as a reference sweep does
+        report(opts, sweep, counts, neg, zero, pos, begin, swept,
+               double(n) * n * n);
+    }
+}
+
+// a derived zero-weight path x·y splits as neg·(pos·y) or pos·(neg·y), both
+// of which the rules build, and likewise for y·x. two cells that were only
+// ever given as input have no such split, hence `made`.
+void closure_doubling(bitmat& neg, bitmat& zero, bitmat& pos,
+                      const path_options& opts)
+{
+    auto begin = clock_type::now();
+    size_t n = zero.dim();
+    size_t counts[3] = {neg.count(), zero.count(), pos.count()};
+    const bitmat given = zero;
+    bitmat made(zero.dim());
+
+    bool changed = true;
+    for (int64_t round = 1; changed; ++round) {
+        auto swept = clock_type::now();
+        changed = mul_or(zero, neg, pos);
+        changed |= mul_or(zero, pos, neg);
+
+        // the zero cells not given on entry
+        for (size_t r = 0; r < n; ++r) {
+            const uint64_t* all = zero.row(r);
+            const uint64_t* in = given.row(r);
+            uint64_t* out = made.row(r);
+            for (size_t w = 0; w < zero.words(); ++w) {
+                out[w] = all[w] & ~in[w];
+            }
+        }
+        changed |= mul_or(zero, made, zero);
+        changed |= mul_or(zero, zero, made);
+
+        changed |= mul_or(pos, pos, zero);
+        changed |= mul_or(pos, zero, pos);
+        changed |= mul_or(neg, neg, zero);
+        changed |= mul_or(neg, zero, neg);
+        report(opts, round, counts, neg, zero, pos, begin, swept,
+               double(n) * n * n);
+    }
+}
+
+// calls fn(k) for each set bit k of a row
+template <typename Fn>
+static void for_each_bit(const uint64_t* row, size_t words, Fn fn)
+{
+    for (size_t w = 0; w < words; ++w) {
+        for (uint64_t bits = row[w]; bits; bits &= bits - 1) {
+            fn(w * 64 + std::countr_zero(bits));
+        }
+    }
+}
+
+// the rows of m with any cell set
+static std::vector<size_t> set_rows(const bitmat& m)
+{
+    std::vector<size_t> rows;
+    for (size_t r = 0; r < m.dim(); ++r) {
+        const uint64_t* row = m.row(r);
+        if (std::any_of(row, row + m.words(), [](uint64_t w) { return w; })) {
+            rows.push_back(r);
+        }
+    }
+    return rows;
+}
+
+namespace {
+// one relation's facts, split by when they were found
+struct relation {
+    bitmat& all;
+    bitmat delta;             // found last round, not yet joined
+    std::vector<size_t> rows; // the rows of delta with anything in them
+    bitmat next;              // found this round
+    bitmat cols;              // all, transposed: row k holds the i of (i, k)
+};
+}
+
+// m transposed
+static bitmat transpose(const bitmat& m)
+{
+    bitmat t(m.dim());
+    for (size_t r = 0; r < m.dim(); ++r) {
+        for_each_bit(m.row(r), m.words(), [&](size_t c) { t.set(c, r); });
+    }
+    return t;
+}
+
+// all |= src over one row, noting the new bits in next. returns whether
+// there were any.
+static bool merge_row(relation& out, size_t r, const uint64_t* src)
+{
+    uint64_t* dst = out.all.row(r);
+    uint64_t* fresh = out.next.row(r);
+    uint64_t any = 0;
+    for (size_t w = 0; w < out.all.words(); ++w) {
+        uint64_t add = src[w] & ~dst[w];
+        dst[w] |= add;
+        fresh[w] |= add;
+        any |= add;
+        for (; add; add &= add - 1) {
+            out.cols.set(w * 64 + std::countr_zero(add), r);
+        }
+    }
+    return any != 0;
+}
+
+// out ⊇ x·y, semi-naively: only pairs with at least one side in a delta can
+// make something new, since every older pair was joined in an earlier round.
+// returns the row unions done.
+static size_t join(relation& out, const relation& x, const relation& y)
+{
+    size_t words = out.all.words();
+    size_t unions = 0;
+    // Δx·y: new (i, k), any (k, j)
+    for (size_t i : x.rows) {
+        for_each_bit(x.delta.row(i), words, [&](size_t k) {
+            merge_row(out, i, y.all.row(k));
+            ++unions;
+        });
+    }
+    // x·Δy: any (i, k), new (k, j), finding the i down column k of x
+    for (size_t k : y.rows) {
+        for_each_bit(x.cols.row(k), words, [&](size_t i) {
+            merge_row(out, i, y.delta.row(k));
+            ++unions;
+        });
+    }
+    return unions;
+}
+
+void closure_worklist(bitmat& neg, bitmat& zero, bitmat& pos,
+                      const path_options& opts)
+{
+    auto begin = clock_type::now();
+    size_t n = zero.dim();
+    size_t counts[3] = {neg.count(), zero.count(), pos.count()};
+
+    // every fact starts out new
+    relation rels[3] = {
+        {neg, neg, set_rows(neg), bitmat(n), transpose(neg)},
+        {zero, zero, set_rows(zero), bitmat(n), transpose(zero)},
+        {pos, pos, set_rows(pos), bitmat(n), transpose(pos)}};
+    auto& [rn, rz, rp] = rels;
+
+    for (int64_t round = 1;
+         !rn.rows.empty() || !rz.rows.empty() || !rp.rows.empty(); ++round) {
+        auto swept = clock_type::now();
+        size_t unions = join(rz, rn, rp);
+        unions += join(rz, rp, rn);
+        unions += join(rp, rp, rz);
+        unions += join(rp, rz, rp);
+        unions += join(rn, rn, rz);
+        unions += join(rn, rz, rn);
+
+        for (auto& rel : rels) {
+            rel.delta = std::exchange(rel.next, bitmat(n));
+            rel.rows = set_rows(rel.delta);
+        }
+        // a row union stands for n (i, j, k) triples
+        report(opts, round, counts, neg, zero, pos, begin, swept,
+               double(unions) * n);
+    }
+}
+
+// rows of a task in the parallel engine
+static constexpr size_t block_rows = 32;
+
+void closure_parallel(bitmat& neg, bitmat& zero, bitmat& pos,
+                      const path_options& opts)
+{
+    auto begin = clock_type::now();
+    size_t n = zero.dim();
+    size_t words = zero.words();
+    steal_pool pool(opts.nthreads, opts.numa);
+    // cells found and row unions done, per worker and sweep
+    epoch_counter found(pool.size());
+    epoch_counter unions(pool.size());
+    size_t counts[3] = {neg.count(), zero.count(), pos.count()};
+
+    // out ⊇ x·y, as indexes into the arrays below
+    struct product {
+        int out, x, y;
+    };
+    static constexpr product products[] = {
+        {1, 0, 2}, {1, 2, 0}, {2, 2, 1}, {2, 1, 2}, {0, 0, 1}, {0, 1, 0},
+    };
+
+    // each block of rows belongs to a worker, which starts every sweep with
+    // the block's task in its deque and is the only one to write the block
+    // outside of tasks.
+    size_t nblocks = (n + block_rows - 1) / block_rows;
+    auto owner = [&](size_t first) {
+        return unsigned(first / block_rows * pool.size() / nblocks);
+    };
+    auto own_rows = [&](unsigned worker, const auto& fn) {
+        for (size_t first = 0; first < n; first += block_rows) {
+            if (owner(first) == worker) {
+                for (size_t i = first; i < std::min(n, first + block_rows);
+                     ++i) {
+                    fn(i);
+                }
+            }
+        }
+    };
+    auto untouched = [&] {
+        return std::array<bitmat, 3>{bitmat(n, bitmat::untouched),
+                                     bitmat(n, bitmat::untouched),
+                                     bitmat(n, bitmat::untouched)};
+    };
+
+    // working copies of the relations, with every row first written by its
+    // owner so that with opts.numa it sits on the owner's node.
+    bitmat* given[3] = {&neg, &zero, &pos};
+    std::array<bitmat, 3> all = untouched();
+    // cells found last sweep; to begin with, everything
+    std::array<bitmat, 3> delta = untouched();
+    // the sweep's starting state, and the cells it finds
+    std::array<bitmat, 3> snap = untouched();
+    std::array<bitmat, 3> next = untouched();
+    pool.each([&](unsigned worker) {
+        own_rows(worker, [&](size_t i) {
+            for (int m = 0; m < 3; ++m) {
+                std::copy_n(given[m]->row(i), words, all[m].row(i));
+                std::copy_n(given[m]->row(i), words, delta[m].row(i));
+                std::fill_n(snap[m].row(i), words, 0);
+                std::fill_n(next[m].row(i), words, 0);
+            }
+        });
+    });
+
+    // runs until a sweep finds nothing, which every worker reports through
+    // `found` rather than a shared flag.
+    for (int64_t sweep = 1;; ++sweep) {
+        // dirty[m] has bit k set when delta[m] has anything in row k
+        std::array<std::vector<uint64_t>, 3> dirty;
+        for (int m = 0; m < 3; ++m) {
+            dirty[m].assign(words, 0);
+            for (size_t k : set_rows(delta[m])) {
+                dirty[m][k / 64] |= uint64_t(1) << (k % 64);
+            }
+        }
+        auto swept = clock_type::now();
+
+        // every task reads the sweep's starting state and writes only its
+        // own rows, so no two workers touch the same word.
+        pool.each([&](unsigned worker) {
+            own_rows(worker, [&](size_t i) {
+                for (int m = 0; m < 3; ++m) {
+                    std::copy_n(all[m].row(i), words, snap[m].row(i));
+                    std::fill_n(next[m].row(i), words, 0);
+                }
+            });
+        });
+
+        // row i has work if it has new cells of x, or cells of x in a
+        // column whose row of y is new
+        auto has_work = [&](size_t i) {
+            for (const auto& [out, x, y] : products) {
+                const uint64_t* xs = snap[x].row(i);
+                const uint64_t* dx = delta[x].row(i);
+                for (size_t w = 0; w < words; ++w) {
+                    if (dx[w] | (xs[w] & dirty[y][w])) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+        // the first rows of the blocks with work; the rest are dropped from
+        // the sweep
+        std::vector<size_t> blocks;
+        for (size_t first = 0; first < n; first += block_rows) {
+            size_t last = std::min(n, first + block_rows);
+            for (size_t i = first; i < last; ++i) {
+                if (has_work(i)) {
+                    blocks.push_back(first);
+                    break;
+                }
+            }
+        }
+
+        auto task = [&](size_t t, unsigned worker) {
+            uint64_t cells = 0, joins = 0;
+            size_t last = std::min(n, blocks[t] + block_rows);
+            for (size_t i = blocks[t]; i < last; ++i) {
+                for (const auto& [out, x, y] : products) {
+                    uint64_t* dst = all[out].row(i);
+                    uint64_t* fresh = next[out].row(i);
+                    auto merge = [&](const uint64_t* src) {
+                        for (size_t w = 0; w < words; ++w) {
+                            uint64_t add = src[w] & ~dst[w];
+                            dst[w] |= add;
+                            fresh[w] |= add;
+                            cells += std::popcount(add);
+                        }
+                        ++joins;
+                    };
+                    // Δx·y
+                    for_each_bit(delta[x].row(i), words,
+                                 [&](size_t k) { merge(snap[y].row(k)); });
+                    // x·Δy
+                    const uint64_t* xs = snap[x].row(i);
+                    for (size_t w = 0; w < words; ++w) {
+                        uint64_t hits = xs[w] & dirty[y][w];
+                        for (; hits; hits &= hits - 1) {
+                            size_t k = w * 64 + std::countr_zero(hits);
+                            merge(delta[y].row(k));
+                        }
+                    }
+                }
+            }
+            found.add(worker, sweep, cells);
+            unions.add(worker, sweep, joins);
+        };
+        auto workers = pool.run(blocks.size(), task,
+                                [&](size_t t) { return owner(blocks[t]); });
+        std::swap(delta, next);
+
+        if (opts.on_sweep) {
+            std::chrono::duration<double> wall = clock_type::now() - swept;
+            std::vector<double> use;
+            for (const auto& w : workers) {
+                use.push_back(w.busy / std::max(wall, decltype(wall)(1e-9)));
+            }
+            // a row union stands for n (i, j, k) triples
+            report(opts, sweep, counts, all[0], all[1], all[2], begin, swept,
+                   double(unions.total(sweep)) * n, std::move(use));
+        }
+        if (found.total(sweep) == 0) {
+            break;
+        }
+    }
+    for (int m = 0; m < 3; ++m) {
+        *given[m] = std::move(all[m]);
+    }
+}
+
+#ifdef TESTING
+#include "doctest.h"
+#include "gen.hpp"
+
+struct test_graph {
+    edge_set edges;
+    adjmat expect; // the reference result
+};
+
+// graphs small enough to check against the O(n⁵) reference quickly. the
+// reference runs once and is shared by every engine's test.
+static const std::vector<test_graph>& test_graphs()
+{
+    static const std::vector<test_graph> graphs = [] {
+        std::vector<test_graph> gs;
+        for (auto edges : {
+                 csg::parse("barbell.csg"),
+                 csg::parse("barbell-10.csg"),
+                 gen::collect(gen::cycle(9)),
+                 gen::collect(gen::grid(3, 4)),
+                 gen::collect(gen::random(18, 0.1, 0.5, 1)),
+                 gen::collect(gen::random(20, 0.08, 0.3, 2)),
+             }) {
+            adjmat expect = exact0paths(edges);
+            gs.push_back({std::move(edges), std::move(expect)});
+        }
+        return gs;
+    }();
+    return graphs;
+}
+
+TEST_CASE("closure_fourrussians")
+{
+    path_options opts;
+    opts.engine = path_engine::fourrussians;
+    for (const auto& g : test_graphs()) {
+        CHECK(exact0paths(g.edges, opts) == g.expect);
+    }
+}
+
+TEST_CASE("closure_worklist")
+{
+    path_options opts;
+    opts.engine = path_engine::worklist;
+    for (const auto& g : test_graphs()) {
+        CHECK(exact0paths(g.edges, opts) == g.expect);
+    }
+}
+
+TEST_CASE("datalog engine")
+{
+    path_options opts;
+    opts.engine = path_engine::datalog;
+    for (const auto& g : test_graphs()) {
+        CHECK(exact0paths(g.edges, opts) == g.expect);
+    }
+}
+
+TEST_CASE("cfl engine")
+{
+    path_options opts;
+    opts.engine = path_engine::cfl;
+    for (const auto& g : test_graphs()) {
+        CHECK(exact0paths(g.edges, opts) == g.expect);
+        adjmat mat(g.edges);
+        CHECK(exact0paths(mat, opts) == g.expect);
+    }
+}
+
+TEST_CASE("closure_parallel")
+{
+    path_options opts;
+    opts.engine = path_engine::parallel;
+    for (unsigned nthreads : {1u, 3u}) {
+        opts.nthreads = nthreads;
+        for (const auto& g : test_graphs()) {
+            CHECK(exact0paths(g.edges, opts) == g.expect);
+        }
+    }
+
+    SUBCASE("numa")
+    {
+        // one node here, most likely; either way the result is the same
+        opts.numa = true;
+        opts.nthreads = 2;
+        for (const auto& g : test_graphs()) {
+            CHECK(exact0paths(g.edges, opts) == g.expect);
+        }
+    }
+
+    SUBCASE("more rows than a block")
+    {
+        auto edges = gen::collect(gen::cycle(70));
+        opts.nthreads = 4;
+        std::vector<sweep_stats> sweeps;
+        opts.on_sweep = [&](const sweep_stats& s) { sweeps.push_back(s); };
+        path_options serial;
+        serial.engine = path_engine::worklist;
+        CHECK(exact0paths(edges, opts) == exact0paths(edges, serial));
+        REQUIRE_FALSE(sweeps.empty());
+        CHECK(sweeps.back().utilization.size() == 4);
+    }
+}
+
+TEST_CASE("closure_doubling")
+{
+    path_options opts;
+    opts.engine = path_engine::doubling;
+    for (const auto& g : test_graphs()) {
+        CHECK(exact0paths(g.edges, opts) == g.expect);
+    }
+
+    SUBCASE("given zero cells")
+    {
+        // two given zero cells in a row don't make a zero path on their own
+        adjmat dm1(3, 2), d0(3, 2), d1(3, 2);
+        d0(0, 1) = 0;
+        d0(1, 2) = 0;
+        adjmat expect = d0;
+        CHECK(exact0paths(dm1, d0, d1, opts) == expect);
+    }
+}
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef BITPATHS_HPP
+#define BITPATHS_HPP
+
+#include "bitmat.hpp"
+#include "paths.hpp"
+
+// boolean formulations of exact0paths.
+//
+// each engine takes D[-1], D[0] and D[1] as relations (neg, zero, pos) and
+// closes them in place under the algorithm's rules
+//
+//      zero ⊇ neg·pos ∪ pos·neg
+//      pos  ⊇ pos·zero ∪ zero·pos
+//      neg  ⊇ neg·zero ∪ zero·neg
+//
+// stopping at the least fixpoint, which is what the reference's 3n² - 1
+// sweeps always reach: a sweep that sets nothing new is a fixpoint, and there
+// are only 3n² cells to set.
+
+// sweeps of the six products as Four Russians boolean matrix multiplies.
+void closure_fourrussians(bitmat& neg, bitmat& zero, bitmat& pos,
+                          const path_options& opts);
+
+// the same products plus zero ⊇ zero·zero once per round, so a run of k
+// zero-weight segments joined end to end is found in log k rounds instead of
+// k. nesting (neg·zero·pos inside another pair) still takes a round a level.
+//
+// zero·zero is only implied by the rules when one side was itself derived,
+// so cells set in `zero` on entry only ever take part through derived ones.
+void closure_doubling(bitmat& neg, bitmat& zero, bitmat& pos,
+                      const path_options& opts);
+
+// semi-naive evaluation, as in Datalog: each round joins only the facts the
+// previous round found against everything known, so the work done is
+// proportional to the facts found rather than n³ a sweep.
+void closure_worklist(bitmat& neg, bitmat& zero, bitmat& pos,
+                      const path_options& opts);
+
+// the worklist's rounds split into blocks of rows, run by opts.nthreads
+// workers stealing blocks from each other. a round reads the cells as they
+// were when it started, so workers never write the same rows; blocks with
+// nothing new to join are dropped from the round altogether.
+void closure_parallel(bitmat& neg, bitmat& zero, bitmat& pos,
+                      const path_options& opts);
+
+#endif
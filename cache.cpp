@@ -0,0 +1,201 @@
+#include "cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <stdlib.h>
+#include <unistd.h>
+
+using std::pair, std::map;
+using std::string;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char magic[4] = {'D', '0', 'B', 'M'};
+constexpr uint32_t version = 1;
+
+struct entry_header {
+    char magic[4];
+    uint32_t version;
+    uint64_t hash;
+    uint64_t dim;
+    uint64_t nedges;
+};
+
+constexpr uint64_t fnv_offset = 0xcbf29ce484222325ull;
+constexpr uint64_t fnv_prime = 0x100000001b3ull;
+
+// feeds v into the hash least significant byte first, independent of host
+// byte order.
+void fnv_mix(uint64_t& h, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i) {
+        h ^= (v >> (8 * i)) & 0xff;
+        h *= fnv_prime;
+    }
+}
+
+} // namespace
+
+uint64_t hash_edges(const edge_set& edges)
+{
+    uint64_t h = fnv_offset;
+    for (const auto& [verts, wt] : edges) {
+        fnv_mix(h, verts.first);
+        fnv_mix(h, verts.second);
+        fnv_mix(h, wt);
+    }
+    return h;
+}
+
+result_cache::result_cache(string dir) : _dir{std::move(dir)}
+{
+    fs::create_directories(_dir);
+}
+
+string result_cache::entry(uint64_t hash) const
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx",
+                  static_cast<unsigned long long>(hash));
+    return (fs::path(_dir) / (string(name) + ".d0")).string();
+}
+
+std::optional<adjmat> result_cache::load(const edge_set& edges) const
+{
+    uint64_t hash = hash_edges(edges);
+    std::ifstream ifile(entry(hash), std::ios::binary);
+    if (!ifile.is_open()) {
+        return std::nullopt;
+    }
+
+    auto vmap = adjmat::gen_vmap(edges);
+    size_t n = vmap.size();
+
+    entry_header hdr;
+    if (!ifile.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)) ||
+        std::memcmp(hdr.magic, magic, sizeof(magic)) != 0 ||
+        hdr.version != version || hdr.hash != hash || hdr.dim != n ||
+        hdr.nedges != edges.size()) {
+        // stale, foreign or colliding entry. treat as a miss.
+        return std::nullopt;
+    }
+
+    std::vector<unsigned char> bits((n * n + 7) / 8);
+    if (!ifile.read(reinterpret_cast<char*>(bits.data()), bits.size())) {
+        return std::nullopt;
+    }
+
+    adjmat d0(n, 2);
+    for (size_t i = 0; i < n * n; ++i) {
+        if (bits[i / 8] & (1u << (i % 8))) {
+            d0(i / n, i % n) = 0;
+        }
+    }
+    d0.vmap(std::move(vmap));
+    return d0;
+}
+
+void result_cache::store(const edge_set& edges, const adjmat& d0) const
+{
+    size_t n = d0.dim();
+    entry_header hdr{};
+    std::memcpy(hdr.magic, magic, sizeof(magic));
+    hdr.version = version;
+    hdr.hash = hash_edges(edges);
+    hdr.dim = n;
+    hdr.nedges = edges.size();
+
+    std::vector<unsigned char> bits((n * n + 7) / 8);
+    for (size_t i = 0; i < n * n; ++i) {
+        if (d0(i / n, i % n) == 0) {
+            bits[i / 8] |= 1u << (i % 8);
+        }
+    }
+
+    // write to a file of our own beside the final entry and rename it over
+    // the entry, so a concurrent reader never sees a partial file and two
+    // writers of the same entry never share one.
+    string path = entry(hdr.hash);
+    string tmp = path + ".XXXXXX";
+    int fd = ::mkstemp(tmp.data());
+    if (fd < 0) {
+        throw std::runtime_error(path + ": failed to create cache entry");
+    }
+    ::close(fd);
+    {
+        std::ofstream ofile(tmp, std::ios::binary | std::ios::trunc);
+        ofile.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        ofile.write(reinterpret_cast<const char*>(bits.data()), bits.size());
+        if (!ofile) {
+            fs::remove(tmp);
+            throw std::runtime_error(tmp + ": failed to write cache entry");
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        fs::remove(tmp);
+        throw std::runtime_error(path + ": " + ec.message());
+    }
+}
+
+#ifdef TESTING
+#include "doctest.h"
+#include "paths.hpp"
+
+#include <thread>
+
+TEST_CASE("result_cache")
+{
+    edge_set edges{
+        {{1, 1}, -1}, {{1, 2}, 1}, {{2, 3}, 1}, {{3, 4}, 1}, {{4, 1}, 1}};
+    edge_set other{{{1, 2}, 1}, {{2, 3}, -1}};
+
+    CHECK(hash_edges(edges) != hash_edges(other));
+
+    auto dir = fs::temp_directory_path() / "lab5-cache-test";
+    fs::remove_all(dir);
+    result_cache cache(dir.string());
+
+    CHECK_FALSE(cache.load(edges).has_value());
+
+    auto d0 = exact0paths(edges);
+    cache.store(edges, d0);
+
+    auto hit = cache.load(edges);
+    REQUIRE(hit.has_value());
+    CHECK(*hit == d0);
+    CHECK(hit->vmap() == d0.vmap());
+    CHECK_FALSE(cache.load(other).has_value());
+
+    SUBCASE("concurrent stores")
+    {
+        // writers of one entry each use their own temporary file
+        std::vector<std::thread> writers;
+        for (int i = 0; i < 8; ++i) {
+            writers.emplace_back([&] {
+                for (int j = 0; j < 20; ++j) {
+                    cache.store(edges, d0);
+                }
+            });
+        }
+        for (auto& w : writers) {
+            w.join();
+        }
+        CHECK(cache.load(edges) == d0);
+        // the one entry and no leftovers
+        auto files = std::distance(fs::directory_iterator(dir),
+                                   fs::directory_iterator());
+        CHECK(files == 1);
+    }
+
+    fs::remove_all(dir);
+}
+
+#endif
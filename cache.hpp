@@ -0,0 +1,33 @@
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include "matrix.hpp"
+
+#include <map>
+#include <string>
+#include <optional>
+#include <cstdint>
+
+// 64-bit FNV-1a hash of an edge set, taken in map (sorted) order so equal
+// graphs hash equally regardless of how their .csg input was written.
+uint64_t hash_edges(const edge_set& edges);
+
+// on-disk cache of exact0paths results keyed by edge set hash.
+//
+// entries store D[0] as a packed bitmap of its zero cells, which is all a
+// result carries; the vertex labelling is rebuilt from the edge set.
+class result_cache {
+public:
+    explicit result_cache(std::string dir);
+
+    std::optional<adjmat> load(const edge_set& edges) const;
+    void store(const edge_set& edges, const adjmat& d0) const;
+
+    // path of the entry for a given hash
+    std::string entry(uint64_t hash) const;
+
+private:
+    std::string _dir;
+};
+
+#endif
@@ -0,0 +1,328 @@
+#include "cfl.hpp"
+
+#include <bit>
+#include <array>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <stdexcept>
+
+bool hybrid_rows::test(size_t r, size_t c) const
+{
+    const row& row = _rows[r];
+    if (row.bits) {
+        return row.bits[c / 64] >> (c % 64) & 1;
+    }
+    return std::binary_search(row.cols.begin(), row.cols.end(), c);
+}
+
+bool hybrid_rows::set(size_t r, size_t c)
+{
+    row& row = _rows[r];
+    if (row.bits) {
+        uint64_t& word = row.bits[c / 64];
+        uint64_t bit = uint64_t(1) << (c % 64);
+        if (word & bit) {
+            return false;
+        }
+        word |= bit;
+        ++_count;
+        return true;
+    }
+
+    auto at = std::lower_bound(row.cols.begin(), row.cols.end(), c);
+    if (at != row.cols.end() && *at == c) {
+        return false;
+    }
+    row.cols.insert(at, uint32_t(c));
+    ++_count;
+    // a column takes half a word, so past two per word the bitset is smaller
+    if (row.cols.size() > 2 * _words) {
+        row.bits = std::make_unique<uint64_t[]>(_words);
+        for (uint32_t col : row.cols) {
+            row.bits[col / 64] |= uint64_t(1) << (col % 64);
+        }
+        std::vector<uint32_t>().swap(row.cols);
+    }
+    return true;
+}
+
+adjmat cfl_result::to_adjmat(std::pmr::memory_resource* mem) const
+{
+    size_t n = _labels.size();
+    vertex_map vmap(mem);
+    for (size_t i = 0; i < n; ++i) {
+        vmap.emplace_hint(vmap.end(), _labels[i], i);
+    }
+    adjmat d0(n, 2, mem);
+    d0.vmap(vmap);
+    for (size_t r = 0; r < n; ++r) {
+        _zero.for_each(r, [&](size_t c) { d0(r, c) = 0; });
+    }
+    return d0;
+}
+
+void cfl_result::write_sparse(std::ostream& os) const
+{
+    std::string buf;
+    for (size_t r = 0; r < _labels.size(); ++r) {
+        _zero.for_each(r, [&](size_t c) {
+            buf += std::to_string(_labels[r]);
+            buf += ' ';
+            buf += std::to_string(_labels[c]);
+            buf += '\n';
+        });
+        if (buf.size() >= 1 << 16) {
+            os << buf;
+            buf.clear();
+        }
+    }
+    os << buf;
+}
+
+namespace {
+
+enum symbol { N, Z, P };
+
+// head → left right
+struct production {
+    symbol head;
+    symbol left;
+    symbol right;
+};
+
+constexpr production productions[] = {
+    {Z, N, P}, {Z, P, N}, {P, P, Z}, {P, Z, P}, {N, N, Z}, {N, Z, N},
+};
+
+// an edge u → v labelled with a symbol
+struct fact {
+    symbol sym;
+    uint32_t u;
+    uint32_t v;
+};
+
+// worklist pops between progress reports
+constexpr size_t batch = 1 << 16;
+
+class solver {
+public:
+    explicit solver(size_t n)
+    {
+        for (int s = 0; s < 3; ++s) {
+            succ.emplace_back(n);
+            pred.emplace_back(n);
+        }
+    }
+
+    void add(symbol sym, size_t u, size_t v)
+    {
+        if (succ[sym].set(u, v)) {
+            pred[sym].set(v, u);
+            work.push_back({sym, uint32_t(u), uint32_t(v)});
+        }
+    }
+
+    void run(const path_options& opts);
+
+    // succ[s] holds the s-labelled edges by source, pred[s] by target
+    std::vector<hybrid_rows> succ;
+    std::vector<hybrid_rows> pred;
+
+private:
+    // calls add(w) for each w set in row r of `from` but not in row u of
+    // `have`. when both rows are bitsets this is the fast-set step, a word at
+    // a time; otherwise it costs the cells in the `from` row. returns the
+    // cells looked at.
+    template <typename Add>
+    size_t join(const hybrid_rows& from, size_t r, const hybrid_rows& have,
+                size_t u, Add add)
+    {
+        if (&from == &have && r == u) {
+            return 0; // nothing in a row is new to itself
+        }
+        const uint64_t* other = from.bits(r);
+        const uint64_t* known = have.bits(u);
+        if (other && known) {
+            for (size_t w = 0; w < have.words(); ++w) {
+                for (uint64_t bits = other[w] & ~known[w]; bits;
+                     bits &= bits - 1) {
+                    add(w * 64 + std::countr_zero(bits));
+                }
+            }
+            return 64 * have.words();
+        }
+        size_t cells = 0;
+        from.for_each(r, [&](size_t w) {
+            ++cells;
+            if (!have.test(u, w)) {
+                add(w);
+            }
+        });
+        return cells;
+    }
+
+    std::vector<fact> work;
+};
+
+void solver::run(const path_options& opts)
+{
+    using clock = std::chrono::steady_clock;
+    size_t n = succ[Z].dim();
+    auto begin = clock::now();
+    auto swept = begin;
+    std::array<size_t, 3> counts{};
+    for (int s = 0; s < 3; ++s) {
+        counts[s] = succ[s].count();
+    }
+    size_t cells = 0;
+
+    auto report = [&](int64_t sweep) {
+        auto now = clock::now();
+        std::chrono::duration<double> took = now - swept;
+        sweep_stats stats{sweep, 3 * int64_t(n * n) - 1};
+        for (int s = 0; s < 3; ++s) {
+            size_t now_count = succ[s].count();
+            stats.changed[s] = now_count - counts[s];
+            counts[s] = now_count;
+        }
+        stats.elapsed = now - begin;
+        // a cell of a join stands for one (i, j, k) triple
+        stats.updates_per_sec = double(cells) / std::max(took.count(), 1e-9);
+        opts.on_sweep(stats);
+        swept = clock::now();
+        cells = 0;
+    };
+
+    int64_t sweep = 0;
+    for (size_t pops = 1; !work.empty(); ++pops) {
+        auto [sym, u, v] = work.back();
+        work.pop_back();
+        for (const auto& [head, left, right] : productions) {
+            // u -sym-> v -right-> w gives u -head-> w
+            if (left == sym) {
+                cells += join(succ[right], v, succ[head], u,
+                              [&](size_t w) { add(head, u, w); });
+            }
+            // w -left-> u -sym-> v gives w -head-> v
+            if (right == sym) {
+                cells += join(pred[left], u, pred[head], v,
+                              [&](size_t w) { add(head, w, v); });
+            }
+        }
+        if (opts.on_sweep && (pops % batch == 0 || work.empty())) {
+            report(++sweep);
+        }
+    }
+}
+
+// the solver with D[-1], D[0] and D[1]'s facts given
+solver given(const adjmat& dm1, const adjmat& d0, const adjmat& d1)
+{
+    solver s(d0.dim());
+    const adjmat* mats[3] = {&dm1, &d0, &d1};
+    for (int m = 0; m < 3; ++m) {
+        for (auto r = 0u; r < d0.dim(); ++r) {
+            const int* cells = mats[m]->row(r);
+            for (auto c = 0u; c < d0.dim(); ++c) {
+                if (cells[c] == m - 1) {
+                    s.add(symbol(m), r, c);
+                }
+            }
+        }
+    }
+    return s;
+}
+
+} // namespace
+
+cfl_result cfl0paths(const edge_set& edges, const path_options& opts)
+{
+    auto vmap = adjmat::gen_vmap(edges);
+    std::vector<int> labels;
+    labels.reserve(vmap.size());
+    for (const auto& [label, idx] : vmap) {
+        labels.push_back(label);
+    }
+
+    solver s(labels.size());
+    for (const auto& [verts, wt] : edges) {
+        if (wt != -1 && wt != 1) {
+            throw std::runtime_error("edge weight must be -1 or 1");
+        }
+        s.add(wt < 0 ? N : P, vmap[verts.first], vmap[verts.second]);
+    }
+    s.run(opts);
+    return cfl_result(std::move(labels), std::move(s.succ[Z]));
+}
+
+adjmat cfl0paths(adjmat& dm1, adjmat& d0, adjmat& d1, const path_options& opts)
+{
+    solver s = given(dm1, d0, d1);
+    s.run(opts);
+    adjmat* mats[3] = {&dm1, &d0, &d1};
+    for (int m = 0; m < 3; ++m) {
+        for (auto r = 0u; r < d0.dim(); ++r) {
+            s.succ[m].for_each(r, [&](size_t c) { (*mats[m])(r, c) = m - 1; });
+        }
+    }
+    return adjmat(d0, opts.resource());
+}
+
+#ifdef TESTING
+#include "doctest.h"
+#include "gen.hpp"
+#include "output.hpp"
+
+#include <sstream>
+
+TEST_CASE("cfl0paths")
+{
+    SUBCASE("hybrid_rows")
+    {
+        hybrid_rows rows(200);
+        CHECK(rows.set(3, 166));
+        CHECK_FALSE(rows.set(3, 166));
+        CHECK(rows.test(3, 166));
+        CHECK_FALSE(rows.test(4, 166));
+        CHECK(rows.bits(3) == nullptr);
+        CHECK(rows.count() == 1);
+
+        // past 2 columns a word the row becomes a bitset
+        std::vector<size_t> cols;
+        for (int c = 199; c >= 0; c -= 23) {
+            CHECK(rows.set(5, c));
+            cols.insert(cols.begin(), c);
+        }
+        CHECK(cols.size() > 2 * rows.words());
+        CHECK(rows.bits(5) != nullptr);
+        CHECK_FALSE(rows.set(5, 199));
+        std::vector<size_t> seen;
+        rows.for_each(5, [&](size_t c) { seen.push_back(c); });
+        CHECK(seen == cols);
+        CHECK(rows.count() == 1 + cols.size());
+    }
+
+    SUBCASE("matches exact0paths")
+    {
+        for (auto edges : {csg::parse("barbell.csg"),
+                           gen::collect(gen::cycle(9)),
+                           gen::collect(gen::random(16, 0.12, 0.5, 3))}) {
+            adjmat expect = exact0paths(edges);
+            cfl_result result = cfl0paths(edges);
+            CHECK(result.to_adjmat() == expect);
+
+            std::ostringstream direct, viamat;
+            result.write_sparse(direct);
+            write_result(viamat, expect, out_format::sparse);
+            CHECK(direct.str() == viamat.str());
+        }
+    }
+
+    SUBCASE("bad weight")
+    {
+        CHECK_THROWS_AS(cfl0paths({{{1, 2}, 3}}), std::runtime_error);
+    }
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef CFL_HPP
+#define CFL_HPP
+
+#include <bit>
+#include <map>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include "matrix.hpp"
+#include "paths.hpp"
+
+// exact0paths as CFL-reachability. read the ±1 edges as the terminals of
+//
+//      Z → N P | P N
+//      P → P Z | Z P | +1
+//      N → N Z | Z N | -1
+//
+// and a zero-cost path from u to v is a Z-labelled path. this is a
+// one-counter language, so the standard worklist algorithm applies: each
+// edge found is joined once with the edges at either end of it.
+
+// square boolean matrix kept by rows, each as small as what is set in it: a
+// sorted list of columns until the list would outgrow a bitset of the row,
+// then that bitset. memory follows the cells set, up to n / 8 bytes a row,
+// rather than n / 8 bytes for every row with anything in it.
+class hybrid_rows {
+public:
+    explicit hybrid_rows(size_t dim)
+        : _dim{dim}, _words{(dim + 63) / 64}, _rows(dim){};
+
+    size_t dim() const { return _dim; }
+    size_t words() const { return _words; }
+
+    // the row's bits if it has been made a bitset, otherwise nullptr. a
+    // bitset row stays one, so the pointer stays good.
+    const uint64_t* bits(size_t r) const { return _rows[r].bits.get(); }
+
+    bool test(size_t r, size_t c) const;
+    // returns whether the cell was clear
+    bool set(size_t r, size_t c);
+
+    // calls fn(c) for each c set in row r, in increasing order
+    template <typename Fn>
+    void for_each(size_t r, Fn fn) const
+    {
+        const row& row = _rows[r];
+        if (!row.bits) {
+            for (uint32_t c : row.cols) {
+                fn(c);
+            }
+            return;
+        }
+        for (size_t w = 0; w < _words; ++w) {
+            for (uint64_t word = row.bits[w]; word; word &= word - 1) {
+                fn(w * 64 + std::countr_zero(word));
+            }
+        }
+    }
+
+    // number of set cells
+    size_t count() const { return _count; }
+
+private:
+    struct row {
+        std::vector<uint32_t> cols;
+        std::unique_ptr<uint64_t[]> bits;
+    };
+
+    size_t _dim;
+    size_t _words;
+    size_t _count = 0;
+    std::vector<row> _rows;
+};
+
+// the zero-cost paths between the vertices of a graph, without the n² ints
+// an adjmat of them would take.
+class cfl_result {
+public:
+    cfl_result(std::vector<int> labels, hybrid_rows zero)
+        : _labels{std::move(labels)}, _zero{std::move(zero)} {};
+
+    // vertex labels in index order
+    const std::vector<int>& labels() const { return _labels; }
+    bool zero(size_t r, size_t c) const { return _zero.test(r, c); }
+    size_t count() const { return _zero.count(); }
+
+    // D[0] as exact0paths returns it, allocated from `mem`
+    adjmat to_adjmat(std::pmr::memory_resource* mem =
+                         std::pmr::get_default_resource()) const;
+    // the sparse output format, one `u v` line per path, in label order
+    void write_sparse(std::ostream& os) const;
+
+private:
+    std::vector<int> _labels;
+    hybrid_rows _zero;
+};
+
+// solves the grammar over an edge set as returned by csg::parse.
+cfl_result cfl0paths(const edge_set& edges, const path_options& opts = {});
+
+// solves it from D[-1], D[0] and D[1], where the cells of D[0] equal to 0 are
+// taken as Z edges, and writes the facts found back into them.
+adjmat cfl0paths(adjmat& dm1, adjmat& d0, adjmat& d1,
+                 const path_options& opts = {});
+
+#endif
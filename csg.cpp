@@ -107,14 +107,33 @@ size_t digest_integer(string_view& s, parse_context& ctx, int& value)
     }
 }
 
-void parse_line(map<pair<int, int>, int>& edges, parse_context& ctx)
+// parses a single line, handing each edge to `fn` as soon as its terminating
+// vertex has been read. only the previous vertex and pending weight are kept,
+// so memory use does not grow with line length.
+void parse_line(const edge_fn& fn, parse_context& ctx)
 {
     // starting a new line.
     ctx.col = 1;
-    // first read in a vector of ints, then deal with the semantics.
-    std::vector<int> vals;
+    // number of values (vertices and weights) read so far on this line.
+    size_t nvals = 0;
+    int prev = 0;
+    int wt = 0;
     string_view line = ctx.line;
 
+    // vertices and weights alternate, starting with a vertex.
+    auto push = [&](int val) {
+        if (nvals % 2 == 0) {
+            if (nvals > 0) {
+                fn({prev, val}, wt);
+            }
+            prev = val;
+        }
+        else {
+            wt = val;
+        }
+        ++nvals;
+    };
+
     // return early if the line is empty or only whitespace
     if (eat_space(line, ctx) == ctx.line.size()) {
         return;
@@ -124,20 +143,11 @@ void parse_line(map<pair<int, int>, int>& edges, parse_context& ctx)
         eat_space(line, ctx);
         int val;
         digest_integer(line, ctx, val);
-        vals.push_back(val);
-
-        if (vals.size() > 2 && (vals.size() - 3) % 2 == 0) {
-            size_t i = vals.size() - 1;
-            auto [v, ins] = edges.insert({{vals[i - 2], vals[i]}, vals[i - 1]});
-            if (!ins) {
-                ostringstream output;
-                output << "edge " << v->first << " already exists";
-                throw parse_error(output.str(), ctx);
-            }
-        }
+        push(val);
+
         eat_space(line, ctx);
         if ((val = maybe_eat_alt_symbol(line, ctx))) {
-            vals.push_back(val);
+            push(val);
             // + or - edge, skip comma check
             continue;
         }
@@ -154,41 +164,45 @@ void parse_line(map<pair<int, int>, int>& edges, parse_context& ctx)
         // integer to parse
     }
 
-    if (vals.empty()) {
+    if (nvals == 0) {
         [[unlikely]] throw parse_error("unreachable", ctx);
     }
-    else if (vals.size() == 1) {
+    else if (nvals == 1) {
         throw parse_error("expected edge", ctx);
     }
-    else if (vals.size() == 2 || (vals.size() - 3) % 2 != 0) {
+    else if (nvals % 2 == 0) {
         throw parse_error("expected vertex", ctx);
     }
 }
 
-map<pair<int, int>, int> parse_with(istream& is, parse_context& ctx)
+void parse_with(istream& is, parse_context& ctx, const edge_fn& fn)
 {
-    map<pair<int, int>, int> edges;
-
     for (string line; std::getline(is, line);) {
         ctx.line = std::move(line); // ctx takes ownership
         ctx.lineno += 1;
-        parse_line(edges, ctx);
+        parse_line(fn, ctx);
     }
-    return edges;
 }
 
-} // namespace
-
-parse_error::parse_error(string_view msg, parse_context ctx)
-    : runtime_error{make_error_message(msg, ctx)}, _where{ctx}
+edge_set parse_with(istream& is, parse_context& ctx,
+                    std::pmr::memory_resource* mem)
 {
+    edge_set edges(mem);
+
+    parse_with(is, ctx, [&](const pair<int, int>& e, int wt) {
+        auto [v, ins] = edges.insert({e, wt});
+        if (!ins) {
+            ostringstream output;
+            output << "edge " << v->first << " already exists";
+            throw parse_error(output.str(), ctx);
+        }
+    });
+    return edges;
 }
 
-// parse a stream of comma-separated graph values into a mapping of edges to
-// weights.
-map<pair<int, int>, int> parse(istream& is)
+// names the context after the stream it reads from
+parse_context stream_context(istream& is)
 {
-
     parse_context ctx{0, 1};
     if (&is == &std::cin) {
         ctx.fname = "<stdin>";
@@ -196,22 +210,58 @@ map<pair<int, int>, int> parse(istream& is)
     else {
         ctx.fname = "<istream>";
     }
-    return parse_with(is, ctx);
+    return ctx;
 }
 
-map<pair<int, int>, int> parse(const std::string& fname)
+std::ifstream open_file(const std::string& fname)
 {
-    parse_context ctx{0, 1};
     std::ifstream ifile(fname);
     if (!ifile.is_open()) {
         ostringstream output;
         output << fname << ": no such file";
         throw std::runtime_error(output.str());
     }
-    else {
-        ctx.fname = fname;
-    }
-    return parse_with(ifile, ctx);
+    return ifile;
+}
+
+} // namespace
+
+parse_error::parse_error(string_view msg, parse_context ctx)
+    : runtime_error{make_error_message(msg, ctx)}, _where{ctx}
+{
+}
+
+// parse a stream of comma-separated graph values into a mapping of edges to
+// weights.
+edge_set parse(istream& is, std::pmr::memory_resource* mem)
+{
+    parse_context ctx = stream_context(is);
+    return parse_with(is, ctx, mem);
+}
+
+edge_set parse(const std::string& fname, std::pmr::memory_resource* mem)
+{
+    parse_context ctx{0, 1};
+    std::ifstream ifile = open_file(fname);
+    ctx.fname = fname;
+    return parse_with(ifile, ctx, mem);
+}
+
+// stream edges to `fn` in input order without building an edge set.
+//
+// duplicate edges are passed through; rejecting them is up to the consumer.
+void parse(istream& is, const edge_fn& fn)
+{
+    parse_context ctx = stream_context(is);
+    parse_with(is, ctx, fn);
+}
+
+void parse(const std::string& fname, const edge_fn& fn)
+{
+    parse_context ctx{0, 1};
+    std::ifstream ifile = open_file(fname);
+    ctx.fname = fname;
+    parse_with(ifile, ctx, fn);
 }
 
 std::ostream& operator<<(std::ostream& os,
@@ -226,8 +276,7 @@ std::ostream& operator<<(std::ostream& os, const pair<int, int>& edge)
     return os << "{" << edge.first << " ━━» " << edge.second << "}";
 }
 
-std::ostream& operator<<(std::ostream& os,
-                         const map<pair<int, int>, int>& edges)
+std::ostream& operator<<(std::ostream& os, const edge_set& edges)
 {
     for (auto edge : edges) {
         os << edge << std::endl;
@@ -245,14 +294,38 @@ TEST_CASE("csg::parse(istream&)")
     std::istringstream in1("1+2-3+4\n1-4");
     std::istringstream in2("1,1,2,-1,3,1,4\n1,-1,4");
 
-    std::map<std::pair<int, int>, int> edges{
-        {{1, 2}, 1}, {{2, 3}, -1}, {{3, 4}, 1}, {{1, 4}, -1}};
+    edge_set edges{{{1, 2}, 1}, {{2, 3}, -1}, {{3, 4}, 1}, {{1, 4}, -1}};
 
     auto t1 = csg::parse(in1);
     auto t2 = csg::parse(in2);
 
     CHECK(t1 == edges);
     CHECK(t2 == edges);
+
+    SUBCASE("duplicate edge")
+    {
+        std::istringstream in3("1+2\n1-2");
+        CHECK_THROWS_AS(csg::parse(in3), csg::parse_error);
+    }
+}
+
+TEST_CASE("csg::parse(istream&, edge_fn)")
+{
+    std::istringstream in1("1+2-3+4\n1-4\n1-4");
+
+    std::vector<std::pair<std::pair<int, int>, int>> streamed;
+    csg::parse(in1, [&](const std::pair<int, int>& e, int wt) {
+        streamed.push_back({e, wt});
+    });
+
+    // input order is preserved and duplicates are left to the consumer.
+    std::vector<std::pair<std::pair<int, int>, int>> edges{
+        {{1, 2}, 1}, {{2, 3}, -1}, {{3, 4}, 1}, {{1, 4}, -1}, {{1, 4}, -1}};
+    CHECK(streamed == edges);
+
+    std::istringstream in2("1,1,2,");
+    CHECK_THROWS_AS(csg::parse(in2, [](const std::pair<int, int>&, int) {}),
+                    csg::parse_error);
 }
 
 #endif
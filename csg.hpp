@@ -4,12 +4,24 @@
 #include <map>
 #include <iostream>
 #include <stdexcept>
+#include <functional>
+
+#include "arena.hpp"
 
 namespace csg {
 
-// {v1, v2, w} = v1 -> {v2, w}
-std::map<std::pair<int, int>, int> parse(std::istream& is);
-std::map<std::pair<int, int>, int> parse(const std::string& fname);
+// {v1, v2, w} = v1 -> {v2, w}, allocated from `mem`, such as a run_arena
+edge_set parse(std::istream& is, std::pmr::memory_resource* mem =
+                                     std::pmr::get_default_resource());
+edge_set parse(const std::string& fname, std::pmr::memory_resource* mem =
+                                             std::pmr::get_default_resource());
+
+// receives each edge {v1, v2} and its weight as soon as it is parsed.
+using edge_fn = std::function<void(const std::pair<int, int>&, int)>;
+
+// streaming variants: memory is bounded by the consumer, not the input.
+void parse(std::istream& is, const edge_fn& fn);
+void parse(const std::string& fname, const edge_fn& fn);
 
 // parse_context owns the current line string.
 struct parse_context {
@@ -31,8 +43,7 @@ private:
 
 // keep these in csg namespace because I'm overloading for a stdlib type which
 // is technically very poor form.
-std::ostream& operator<<(std::ostream&,
-                         const std::map<std::pair<int, int>, int>&);
+std::ostream& operator<<(std::ostream&, const edge_set&);
 std::ostream& operator<<(std::ostream&, const std::pair<int, int>&);
 std::ostream& operator<<(std::ostream&,
                          const std::pair<std::pair<int, int>, int>&);
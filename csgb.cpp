@@ -0,0 +1,223 @@
+#include "csgb.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+using std::pair, std::map;
+using std::string;
+
+namespace csg {
+
+namespace {
+
+template<class T>
+void write_raw(std::ostream& os, const T* p, size_t n)
+{
+    os.write(reinterpret_cast<const char*>(p), sizeof(T) * n);
+}
+
+std::runtime_error format_error(const string& fname, const string& msg)
+{
+    return std::runtime_error(fname + ": " + msg);
+}
+
+} // namespace
+
+void compile(const edge_set& edges, std::ostream& os)
+{
+    auto vmap = adjmat::gen_vmap(edges);
+
+    csgb_header hdr{};
+    std::memcpy(hdr.magic, csgb_magic, sizeof(hdr.magic));
+    hdr.version = csgb_version;
+    hdr.bom = csgb_bom;
+    hdr.order = vmap.size();
+    hdr.size = edges.size();
+    write_raw(os, &hdr, 1);
+
+    std::vector<int32_t> labels;
+    labels.reserve(vmap.size());
+    for (const auto& [label, idx] : vmap) {
+        labels.push_back(label);
+    }
+    write_raw(os, labels.data(), labels.size());
+
+    // map order on labels is also index order, so edges come out sorted.
+    std::vector<csgb_edge> recs;
+    recs.reserve(edges.size());
+    for (const auto& [verts, wt] : edges) {
+        recs.push_back({static_cast<uint32_t>(vmap.at(verts.first)),
+                        static_cast<uint32_t>(vmap.at(verts.second)), wt});
+    }
+    write_raw(os, recs.data(), recs.size());
+
+    if (!os) {
+        throw std::runtime_error("failed to write compiled graph");
+    }
+}
+
+void compile(const edge_set& edges, const string& fname)
+{
+    std::ofstream ofile(fname, std::ios::binary);
+    if (!ofile.is_open()) {
+        throw std::runtime_error(fname + ": cannot open for writing");
+    }
+    compile(edges, ofile);
+}
+
+compiled_graph::compiled_graph(const string& fname) : _file{fname}
+{
+    const std::byte* base = _file.data();
+    size_t len = _file.size();
+
+    csgb_header hdr;
+    if (len < sizeof(hdr)) {
+        throw format_error(fname, "not a compiled graph");
+    }
+    std::memcpy(&hdr, base, sizeof(hdr));
+    if (std::memcmp(hdr.magic, csgb_magic, sizeof(hdr.magic)) != 0) {
+        throw format_error(fname, "not a compiled graph");
+    }
+    if (hdr.bom != csgb_bom) {
+        throw format_error(fname, "compiled graph has foreign byte order");
+    }
+    if (hdr.version != csgb_version) {
+        throw format_error(fname, "unsupported compiled graph version " +
+                                      std::to_string(hdr.version));
+    }
+
+    // sized by what the file holds rather than by the header's counts, which
+    // a corrupt file could make wrap around to a plausible length.
+    size_t body = len - sizeof(hdr);
+    if (hdr.order > body / sizeof(int32_t)) {
+        throw format_error(fname, "truncated compiled graph");
+    }
+    size_t lbytes = hdr.order * sizeof(int32_t);
+    size_t ebytes = body - lbytes;
+    if (hdr.size != ebytes / sizeof(csgb_edge) ||
+        ebytes % sizeof(csgb_edge) != 0) {
+        throw format_error(fname, "truncated compiled graph");
+    }
+
+    // header and label sizes keep both arrays 4-byte aligned in the mapping.
+    _labels = {reinterpret_cast<const int32_t*>(base + sizeof(hdr)),
+               hdr.order};
+    _edges = {reinterpret_cast<const csgb_edge*>(base + sizeof(hdr) + lbytes),
+              hdr.size};
+
+    for (const auto& e : _edges) {
+        if (e.src >= hdr.order || e.dst >= hdr.order) {
+            throw format_error(fname, "edge references unknown vertex");
+        }
+        if (e.wt != -1 && e.wt != 1) {
+            throw format_error(fname, "edge weight must be -1 or 1");
+        }
+    }
+}
+
+vertex_map compiled_graph::vmap() const
+{
+    vertex_map vm;
+    for (size_t i = 0; i < _labels.size(); ++i) {
+        vm.insert(vm.cend(), {_labels[i], i});
+    }
+    return vm;
+}
+
+edge_set compiled_graph::edge_map(std::pmr::memory_resource* mem) const
+{
+    edge_set em(mem);
+    for (const auto& e : _edges) {
+        em.insert(em.cend(), {{_labels[e.src], _labels[e.dst]}, e.wt});
+    }
+    return em;
+}
+
+adjmat compiled_graph::to_adjmat() const
+{
+    size_t n = order();
+    adjmat mat(n, 2);
+    for (const auto& e : _edges) {
+        mat(e.src, e.dst) = e.wt;
+    }
+    mat.vmap(vmap());
+    return mat;
+}
+
+} // namespace csg
+
+#ifdef TESTING
+#include "doctest.h"
+
+#include <filesystem>
+#include <sstream>
+
+TEST_CASE("csg::compile")
+{
+    edge_set edges{
+        {{1, 2}, 1}, {{2, 3}, -1}, {{3, 4}, 1}, {{1, 4}, -1}, {{7, 1}, 1}};
+    auto fname =
+        (std::filesystem::temp_directory_path() / "lab5-csgb-test.csgb")
+            .string();
+
+    csg::compile(edges, fname);
+    {
+        csg::compiled_graph g(fname);
+
+        CHECK(g.order() == 5);
+        CHECK(g.size() == edges.size());
+        CHECK(g.edge_map() == edges);
+        CHECK(g.to_adjmat() == adjmat(edges));
+        CHECK(g.to_adjmat().vmap() == adjmat(edges).vmap());
+    }
+
+    SUBCASE("rejects foreign files")
+    {
+        std::ofstream(fname) << "1+2\n";
+        CHECK_THROWS_AS(csg::compiled_graph{fname}, std::runtime_error);
+    }
+
+    SUBCASE("rejects corrupt counts and weights")
+    {
+        std::stringstream buf;
+        csg::compile(edges, buf);
+        string good = buf.str();
+        auto rewrite = [&](auto edit) {
+            string bytes = good;
+            csg::csgb_header hdr;
+            std::memcpy(&hdr, bytes.data(), sizeof(hdr));
+            edit(hdr, bytes);
+            std::memcpy(bytes.data(), &hdr, sizeof(hdr));
+            std::ofstream(fname, std::ios::binary) << bytes;
+        };
+
+        // 4 * 2^62 labels wrap to 0 bytes, leaving the length unchanged
+        rewrite([](csg::csgb_header& hdr, string&) {
+            hdr.order += uint64_t(1) << 62;
+        });
+        CHECK_THROWS_WITH(csg::compiled_graph{fname},
+                          (fname + ": truncated compiled graph").c_str());
+        rewrite([](csg::csgb_header& hdr, string&) { hdr.size += 1; });
+        CHECK_THROWS_WITH(csg::compiled_graph{fname},
+                          (fname + ": truncated compiled graph").c_str());
+        rewrite([](csg::csgb_header&, string& bytes) { bytes.pop_back(); });
+        CHECK_THROWS_WITH(csg::compiled_graph{fname},
+                          (fname + ": truncated compiled graph").c_str());
+
+        rewrite([](csg::csgb_header&, string& bytes) {
+            csg::csgb_edge e;
+            size_t at = bytes.size() - sizeof(e);
+            std::memcpy(&e, bytes.data() + at, sizeof(e));
+            e.wt = 2;
+            std::memcpy(bytes.data() + at, &e, sizeof(e));
+        });
+        CHECK_THROWS_WITH(csg::compiled_graph{fname},
+                          (fname + ": edge weight must be -1 or 1").c_str());
+    }
+
+    std::filesystem::remove(fname);
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef CSGB_HPP
+#define CSGB_HPP
+
+#include "mapfile.hpp"
+#include "matrix.hpp"
+
+#include <map>
+#include <span>
+#include <string>
+#include <cstdint>
+#include <iostream>
+
+namespace csg {
+
+// compiled .csg (csgb) format. all fields are in host byte order; `bom` lets
+// a reader reject files written on a machine of the other endianness.
+//
+//      header
+//      int32_t  labels[order]      sorted vertex labels, index == vmap value
+//      edge     edges[size]        sorted by (src, dst)
+struct csgb_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t bom;
+    uint32_t reserved;
+    uint64_t order; // number of vertices
+    uint64_t size;  // number of edges
+};
+
+// edge between vertex *indices*, not labels.
+struct csgb_edge {
+    uint32_t src;
+    uint32_t dst;
+    int32_t wt;
+};
+
+inline constexpr char csgb_magic[4] = {'C', 'S', 'G', 'B'};
+inline constexpr uint32_t csgb_version = 1;
+inline constexpr uint32_t csgb_bom = 0x01020304;
+
+// writes an edge set and its vertex labelling in the compiled format.
+void compile(const edge_set& edges, std::ostream& os);
+void compile(const edge_set& edges, const std::string& fname);
+
+// a compiled graph used in place from a read-only mapping of the file.
+class compiled_graph {
+public:
+    explicit compiled_graph(const std::string& fname);
+
+    size_t order() const { return _labels.size(); }
+    size_t size() const { return _edges.size(); }
+
+    std::span<const int32_t> labels() const { return _labels; }
+    std::span<const csgb_edge> edges() const { return _edges; }
+
+    // the same labelling adjmat::gen_vmap produces for the source edge set
+    vertex_map vmap() const;
+    // the source edge set, as csg::parse returns it
+    edge_set edge_map(std::pmr::memory_resource* mem =
+                          std::pmr::get_default_resource()) const;
+    // equivalent to adjmat(edge_map()) without building the edge map
+    adjmat to_adjmat() const;
+
+private:
+    mapped_file _file;
+    std::span<const int32_t> _labels;
+    std::span<const csgb_edge> _edges;
+};
+
+} // namespace csg
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef DATALOG_HPP
+#define DATALOG_HPP
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unordered_set>
+
+// a small semi-naive Datalog evaluator for binary relations over the
+// vertices 0..n-1, enough to state exact0paths as rules like
+//
+//      zero(i, j) :- neg(i, k), pos(k, j).
+namespace datalog {
+
+// a set of (a, b) tuples, indexed by both columns so a join can look up
+// either side of a new tuple.
+class relation {
+public:
+    explicit relation(size_t n) : _n{n}, _succ(n), _pred(n){};
+
+    // returns whether the tuple is new
+    bool insert(int a, int b);
+    bool contains(int a, int b) const;
+
+    // the b of each (a, b), and the a of each (a, b)
+    const std::vector<int>& succ(int a) const { return _succ[a]; }
+    const std::vector<int>& pred(int b) const { return _pred[b]; }
+
+    // the vertex count, and the tuple count
+    size_t dim() const { return _n; }
+    size_t size() const { return _tuples.size(); }
+
+private:
+    uint64_t key(int a, int b) const { return uint64_t(a) * _n + b; }
+
+    size_t _n;
+    std::unordered_set<uint64_t> _tuples;
+    std::vector<std::vector<int>> _succ;
+    std::vector<std::vector<int>> _pred;
+};
+
+// head(i, j) :- left(i, k), right(k, j), naming relations by index.
+struct rule {
+    size_t head;
+    size_t left;
+    size_t right;
+};
+
+// what a round of evaluation did
+struct round_stats {
+    int64_t round;
+    std::vector<size_t> found; // new tuples, per relation
+    size_t joins;              // tuple pairs looked at
+};
+
+// adds to `rels` everything the rules derive from them, stopping at the
+// least fixpoint. each round joins only the tuples the previous round found
+// (the deltas) against the full relations; any older pair has already been
+// joined.
+void evaluate(std::vector<relation>& rels, const std::vector<rule>& rules,
+              const std::function<void(const round_stats&)>& on_round = {});
+
+} // namespace datalog
+
+#endif
@@ -0,0 +1,261 @@
+#include "gen.hpp"
+#include "render.hpp"
+
+#include <cmath>
+#include <random>
+#include <limits>
+#include <cstdint>
+#include <vector>
+#include <charconv>
+#include <stdexcept>
+
+using std::string, std::string_view;
+
+namespace gen {
+
+generator barbell(int n)
+{
+    if (n < 5) {
+        throw std::runtime_error("barbell needs at least 5 vertices");
+    }
+    return [n](const csg::edge_fn& fn) {
+        // left bell 0..l-1, bridge vertex l, right bell l+1..n-1
+        int l = (n - 2) / 2;
+        for (int v = 0; v < l; ++v) {
+            fn({v, (v + 1) % l}, 1);
+        }
+        fn({l - 1, l}, 1);
+        fn({l, l + 1}, -1);
+        int r = n - l - 1;
+        for (int v = 0; v < r; ++v) {
+            fn({l + 1 + v, l + 1 + (v + 1) % r}, -1);
+        }
+    };
+}
+
+generator cycle(int n)
+{
+    if (n < 1) {
+        throw std::runtime_error("cycle needs at least 1 vertex");
+    }
+    return [n](const csg::edge_fn& fn) {
+        for (int v = 0; v < n; ++v) {
+            fn({v, (v + 1) % n}, v % 2 ? -1 : 1);
+        }
+    };
+}
+
+generator random(int n, double density, double neg, uint64_t seed)
+{
+    if (n < 1 || !(density >= 0 && density <= 1) || !(neg >= 0 && neg <= 1)) {
+        throw std::runtime_error("random needs n >= 1 and 0 <= density, neg <= 1");
+    }
+    return [=](const csg::edge_fn& fn) {
+        if (density == 0 || n == 1) {
+            return;
+        }
+        std::mt19937_64 rng(seed);
+        std::uniform_real_distribution<double> unit(0, 1);
+        uint64_t pairs = uint64_t(n) * (n - 1);
+
+        // jump straight from one present edge to the next: the gap between
+        // successes of independent trials is geometrically distributed.
+        double logq = std::log1p(-density);
+        auto gap = [&]() -> uint64_t {
+            if (density == 1) {
+                return 0;
+            }
+            double g = std::floor(std::log(1 - unit(rng)) / logq);
+            return g >= double(pairs) ? pairs : uint64_t(g);
+        };
+
+        for (uint64_t idx = gap(); idx < pairs; idx += 1 + gap()) {
+            // pair index to (u, v), skipping the loop v == u
+            int u = idx / (n - 1);
+            int v = idx % (n - 1);
+            v += v >= u;
+            fn({u, v}, unit(rng) < neg ? -1 : 1);
+        }
+    };
+}
+
+generator grid(int w, int h)
+{
+    if (w < 1 || h < 1 || (w == 1 && h == 1)) {
+        throw std::runtime_error("grid needs at least 2 vertices");
+    }
+    // vertices are labelled y * w + x
+    if (int64_t(w) * h > std::numeric_limits<int>::max()) {
+        throw std::runtime_error("grid has more vertices than int labels");
+    }
+    return [w, h](const csg::edge_fn& fn) {
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                int v = y * w + x;
+                if (x + 1 < w) {
+                    fn({v, v + 1}, 1);
+                }
+                if (y + 1 < h) {
+                    fn({v, v + w}, -1);
+                }
+            }
+        }
+    };
+}
+
+namespace {
+
+std::vector<string_view> split(string_view s)
+{
+    std::vector<string_view> parts;
+    for (size_t pos; (pos = s.find(':')) != s.npos; s.remove_prefix(pos + 1)) {
+        parts.push_back(s.substr(0, pos));
+    }
+    parts.push_back(s);
+    return parts;
+}
+
+template<class T>
+T number(string_view s, string_view spec)
+{
+    T val{};
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), val);
+    if (ec != std::errc() || ptr != s.data() + s.size()) {
+        throw std::runtime_error("invalid generator spec '" + string(spec) +
+                                 "'");
+    }
+    return val;
+}
+
+} // namespace
+
+generator from_spec(string_view spec)
+{
+    auto parts = split(spec);
+    auto arg = [&]<class T>(size_t i, T dflt) {
+        return i < parts.size() ? number<T>(parts[i], spec) : dflt;
+    };
+    auto arity = [&](size_t lo, size_t hi) {
+        if (parts.size() < lo + 1 || parts.size() > hi + 1) {
+            throw std::runtime_error("invalid generator spec '" +
+                                     string(spec) + "'");
+        }
+    };
+
+    string_view family = parts[0];
+    if (family == "barbell") {
+        arity(1, 1);
+        return barbell(arg(1, 0));
+    }
+    else if (family == "cycle") {
+        arity(1, 1);
+        return cycle(arg(1, 0));
+    }
+    else if (family == "random") {
+        arity(2, 4);
+        return random(arg(1, 0), arg(2, 0.0), arg(3, 0.5), arg(4, uint64_t(1)));
+    }
+    else if (family == "grid") {
+        arity(2, 2);
+        return grid(arg(1, 0), arg(2, 0));
+    }
+    throw std::runtime_error("unknown graph family '" + string(family) + "'");
+}
+
+void write(std::ostream& os, const generator& g)
+{
+    string buf;
+    buf.reserve(1 << 17);
+    g([&](const std::pair<int, int>& e, int wt) {
+        append_int(buf, e.first, 0);
+        if (wt == 1 || wt == -1) {
+            buf += wt == 1 ? '+' : '-';
+        }
+        else {
+            buf += ',';
+            append_int(buf, wt, 0);
+            buf += ',';
+        }
+        append_int(buf, e.second, 0);
+        buf += '\n';
+        if (buf.size() >= (1 << 16)) {
+            os.write(buf.data(), buf.size());
+            buf.clear();
+        }
+    });
+    os.write(buf.data(), buf.size());
+}
+
+edge_set collect(const generator& g)
+{
+    edge_set edges;
+    g([&](const std::pair<int, int>& e, int wt) { edges[e] = wt; });
+    return edges;
+}
+
+} // namespace gen
+
+#ifdef TESTING
+#include "doctest.h"
+#include "matrix.hpp"
+
+#include <sstream>
+
+TEST_CASE("gen")
+{
+    SUBCASE("barbell matches the bundled files")
+    {
+        CHECK(gen::collect(gen::barbell(10)) == csg::parse("barbell-10.csg"));
+
+        // barbell-8.csg bridges from another vertex of the left bell.
+        auto b8 = gen::collect(gen::barbell(8));
+        auto f8 = csg::parse("barbell-8.csg");
+        CHECK(b8.size() == f8.size());
+        CHECK(adjmat::gen_vmap(b8) == adjmat::gen_vmap(f8));
+    }
+
+    SUBCASE("written graphs parse back")
+    {
+        for (auto spec : {"cycle:7", "grid:4:3", "random:40:0.1:0.3:9"}) {
+            auto g = gen::from_spec(spec);
+            std::stringstream out;
+            gen::write(out, g);
+            CHECK(csg::parse(out) == gen::collect(g));
+        }
+    }
+
+    SUBCASE("random")
+    {
+        auto edges = gen::collect(gen::random(200, 0.05, 0.25, 3));
+        // 39800 possible edges; expect about 1990 of them.
+        CHECK(edges.size() > 1700);
+        CHECK(edges.size() < 2300);
+
+        size_t negs = 0;
+        for (const auto& [verts, wt] : edges) {
+            CHECK(verts.first != verts.second);
+            negs += wt == -1;
+        }
+        CHECK(negs > edges.size() / 8);
+        CHECK(negs < edges.size() * 3 / 8);
+
+        CHECK(gen::collect(gen::random(5, 1, 0)).size() == 20);
+        CHECK(edges == gen::collect(gen::random(200, 0.05, 0.25, 3)));
+    }
+
+    SUBCASE("grid")
+    {
+        // 3 rows of 2 rightward edges, 2 rows of 3 downward ones
+        CHECK(gen::collect(gen::grid(3, 3)).size() == 12);
+    }
+
+    CHECK_THROWS_AS(gen::from_spec("cycle"), std::runtime_error);
+    CHECK_THROWS_AS(gen::from_spec("cycle:x"), std::runtime_error);
+    CHECK_THROWS_AS(gen::from_spec("star:4"), std::runtime_error);
+    // 2.5 billion vertices can't be labelled with an int
+    CHECK_THROWS_WITH(gen::from_spec("grid:50000:50000"),
+                      "grid has more vertices than int labels");
+    CHECK_NOTHROW(gen::from_spec("grid:46340:46340"));
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef GEN_HPP
+#define GEN_HPP
+
+#include "csg.hpp"
+
+#include <map>
+#include <string>
+#include <cstdint>
+#include <iostream>
+#include <functional>
+#include <string_view>
+
+// synthetic graph families for scale testing. generators hand each edge to a
+// callback as it is produced, so graphs of any size are never held in memory.
+namespace gen {
+
+// hands every edge of a graph to the callback
+using generator = std::function<void(const csg::edge_fn&)>;
+
+// n vertices: a +1 cycle and a -1 cycle joined by a +1 -1 bridge through one
+// vertex, laid out like barbell-8.csg and barbell-10.csg.
+generator barbell(int n);
+
+// a single cycle of n vertices with alternating +1 and -1 edges.
+generator cycle(int n);
+
+// each of the n(n - 1) possible non-loop edges is present with probability
+// `density` and weighted -1 with probability `neg`. O(edges), not O(n²).
+generator random(int n, double density, double neg = 0.5, uint64_t seed = 1);
+
+// a w by h grid with +1 edges rightward and -1 edges downward.
+generator grid(int w, int h);
+
+// parses one of
+//      barbell:N
+//      cycle:N
+//      random:N:DENSITY[:NEG[:SEED]]
+//      grid:W:H
+generator from_spec(std::string_view spec);
+
+// writes every edge in .csg syntax, one per line
+void write(std::ostream& os, const generator& g);
+
+// collects the edges into the map csg::parse would return
+edge_set collect(const generator& g);
+
+} // namespace gen
+
+#endif
@@ -0,0 +1,139 @@
+#include "hugepage.hpp"
+
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+#include <sys/mman.h>
+
+hugepage_mode parse_hugepages(std::string_view name)
+{
+    if (name == "off") {
+        return hugepage_mode::off;
+    }
+    else if (name == "transparent" || name == "thp") {
+        return hugepage_mode::transparent;
+    }
+    else if (name == "explicit") {
+        return hugepage_mode::explicit_pages;
+    }
+    throw std::runtime_error("unknown huge page mode '" + std::string(name) +
+                             "'");
+}
+
+static size_t round_up(size_t bytes)
+{
+    size_t huge = hugepage_resource::huge_size;
+    return (bytes + huge - 1) / huge * huge;
+}
+
+bool hugepage_resource::mapped(size_t bytes, size_t align) const
+{
+    return _mode != hugepage_mode::off && bytes >= huge_size &&
+           align <= huge_size;
+}
+
+void* hugepage_resource::do_allocate(size_t bytes, size_t align)
+{
+    if (!mapped(bytes, align)) {
+        return _upstream->allocate(bytes, align);
+    }
+    size_t size = round_up(bytes);
+
+#ifdef MAP_HUGETLB
+    if (_mode == hugepage_mode::explicit_pages) {
+        void* p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            ++_mapped;
+            ++_explicit;
+            return p;
+        }
+        // the pool is empty or not configured: use transparent pages
+    }
+#endif
+
+    // a huge page can only back a 2 MiB aligned range, so map a huge page
+    // more than needed and trim the ends to alignment.
+    void* raw = ::mmap(nullptr, size + huge_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    auto start = reinterpret_cast<uintptr_t>(raw);
+    auto aligned = (start + huge_size - 1) / huge_size * huge_size;
+    if (aligned > start) {
+        ::munmap(raw, aligned - start);
+    }
+    if (size_t tail = start + size + huge_size - (aligned + size)) {
+        ::munmap(reinterpret_cast<void*>(aligned + size), tail);
+    }
+    void* p = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+    // only advice: without THP support the buffer is simply ordinary pages
+    ::madvise(p, size, MADV_HUGEPAGE);
+#endif
+    ++_mapped;
+    return p;
+}
+
+void hugepage_resource::do_deallocate(void* p, size_t bytes, size_t align)
+{
+    if (!mapped(bytes, align)) {
+        _upstream->deallocate(p, bytes, align);
+        return;
+    }
+    // both kinds of mapping cover exactly the rounded size
+    ::munmap(p, round_up(bytes));
+}
+
+#ifdef TESTING
+#include "doctest.h"
+#include "matrix.hpp"
+
+#include <cstring>
+
+TEST_CASE("hugepage_resource")
+{
+    CHECK(parse_hugepages("thp") == hugepage_mode::transparent);
+    CHECK(parse_hugepages("explicit") == hugepage_mode::explicit_pages);
+    CHECK_THROWS_AS(parse_hugepages("big"), std::runtime_error);
+
+    for (auto mode : {hugepage_mode::off, hugepage_mode::transparent,
+                      hugepage_mode::explicit_pages}) {
+        hugepage_resource res(mode);
+        size_t bytes = 3 * hugepage_resource::huge_size + 12;
+        void* p = res.allocate(bytes, alignof(int));
+        std::memset(p, 0x5a, bytes);
+        if (mode != hugepage_mode::off) {
+            CHECK(res.mapped() == 1);
+            CHECK(reinterpret_cast<uintptr_t>(p) %
+                      hugepage_resource::huge_size ==
+                  0);
+        }
+        res.deallocate(p, bytes, alignof(int));
+
+        // small buffers are the upstream's
+        void* q = res.allocate(64, 8);
+        res.deallocate(q, 64, 8);
+        CHECK(res.mapped() == (mode == hugepage_mode::off ? 0 : 1));
+    }
+
+    SUBCASE("adjmat cells")
+    {
+        hugepage_resource res(hugepage_mode::transparent);
+        auto* old = std::pmr::set_default_resource(&res);
+        {
+            // 1024² ints is 4 MiB
+            adjmat big(1024, 2);
+            big(1023, 1023) = 0;
+            adjmat copy = big;
+            CHECK(copy == big);
+            adjmat small(8, 2);
+        }
+        std::pmr::set_default_resource(old);
+        CHECK(res.mapped() == 2);
+    }
+}
+
+#endif
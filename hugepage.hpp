@@ -0,0 +1,60 @@
+#ifndef HUGEPAGE_HPP
+#define HUGEPAGE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <string_view>
+#include <memory_resource>
+
+// how large buffers are backed.
+//
+//  off          the upstream resource, as if there were no hugepage_resource
+//  transparent  anonymous mappings marked MADV_HUGEPAGE, so the kernel backs
+//               them with transparent huge pages where it can
+//  explicit     MAP_HUGETLB mappings from the reserved huge page pool (see
+//               /proc/sys/vm/nr_hugepages), falling back to transparent
+//               pages when the pool can't supply them
+enum class hugepage_mode { off, transparent, explicit_pages };
+
+hugepage_mode parse_hugepages(std::string_view name);
+
+// memory_resource for large buffers such as an adjmat's cells, which the
+// path engine walks down columns a row apart: with 4 KiB pages nearly every
+// step is a TLB miss once n is in the thousands. allocations of at least
+// `huge_size` are given their own 2 MiB aligned mapping; smaller ones go to
+// the upstream resource. install it with std::pmr::set_default_resource.
+class hugepage_resource : public std::pmr::memory_resource {
+public:
+    // the huge page size assumed throughout, the common x86-64 and arm64 one
+    static constexpr size_t huge_size = size_t(2) << 20;
+
+    explicit hugepage_resource(
+        hugepage_mode mode,
+        std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : _mode{mode}, _upstream{upstream} {};
+
+    hugepage_mode mode() const { return _mode; }
+
+    // buffers given their own mapping so far, and how many of those came
+    // from the explicit pool
+    size_t mapped() const { return _mapped; }
+    size_t explicit_mapped() const { return _explicit; }
+
+private:
+    void* do_allocate(size_t bytes, size_t align) override;
+    void do_deallocate(void* p, size_t bytes, size_t align) override;
+    bool do_is_equal(const memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    // whether an allocation of this size gets its own mapping
+    bool mapped(size_t bytes, size_t align) const;
+
+    hugepage_mode _mode;
+    std::pmr::memory_resource* _upstream;
+    std::atomic<size_t> _mapped{0};
+    std::atomic<size_t> _explicit{0};
+};
+
+#endif
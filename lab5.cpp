@@ -1,11 +1,23 @@
-#ifndef TESTING
+#ifndef BENCHMARK
 
 #include "csg.hpp"
 #include "matrix.hpp"
 #include "tcolor.hpp"
 #include "paths.hpp"
+#include "csgb.hpp"
+#include "cache.hpp"
+#include "output.hpp"
+#include "gen.hpp"
+#include "cfl.hpp"
+#include "hugepage.hpp"
 
+#include <algorithm>
+#include <charconv>
 #include <fstream>
+#include <future>
+#include <limits>
+#include <optional>
+#include <ranges>
 #include <stdexcept>
 #include <getopt.h>
 
@@ -20,40 +32,270 @@ static std::string usage()
     use += "\tlab5.out -c file" + string(4 * 3, ' ') + "read .csg file\n";
     use +=
         "\tlab5.out -i" + string(4 * 5 - 3, ' ') + "read.csg file from stdin\n";
+    use += "\tlab5.out -b file" + string(4 * 3, ' ') +
+           "read compiled .csgb file\n";
+    use += "\tlab5.out --compile in out" + string(4 - 1, ' ') +
+           "compile .csg file to .csgb\n";
+    use += "\tlab5.out --generate spec" + string(4, ' ') +
+           "write a synthetic .csg graph to stdout\n";
+    use += BOLD "options:\n" RESET;
+    use += "\t--cache dir" + string(4 * 4 + 1, ' ') +
+           "reuse results cached in dir\n";
+    use += "\t--format=fmt" + string(4 * 4, ' ') +
+           "box (default), sparse, dense or csv\n";
+    use += "\t-j n" + string(4 * 6, ' ') + "use n threads\n";
+    use += "\t--rows a:b --cols c:d" + string(4 + 3, ' ') +
+           "only show vertices labelled a..b by c..d\n";
+    use += "\t--save file" + string(4 * 4 + 1, ' ') +
+           "also save the result matrix to file\n";
+    use += "\t--checkpoint file" + string(4 * 2 + 3, ' ') +
+           "periodically save progress to file\n";
+    use += "\t--checkpoint-every s" + string(4 * 2, ' ') +
+           "seconds between checkpoints (default 300)\n";
+    use += "\t--resume" + string(4 * 5, ' ') +
+           "continue from the checkpoint if there is one\n";
+    use += "\t--progress" + string(4 * 4 + 2, ' ') +
+           "report sweep statistics on stderr\n";
+    use += "\t--engine=name" + string(4 * 4 - 1, ' ') +
+           "path engine (default reference), see README\n";
+    use += "\t--numa" + string(4 * 5 + 2, ' ') +
+           "place parallel engine rows on their workers' nodes\n";
+    use += "\t--hugepages=mode" + string(4 * 3, ' ') +
+           "experimental: off (default), thp or explicit\n";
     return use;
 }
 
 // does the thing the assignment page requires
-static adjmat do_3file_input(char** argv)
+//
+// the three matrices are read concurrently so startup is bounded by the
+// largest file rather than the sum of all three.
+static adjmat do_3file_input(char** argv, const path_options& opts)
 {
-    std::ifstream ifiles[] = {ifstream(argv[0]), ifstream(argv[1]),
-                              ifstream(argv[2])};
-
+    std::future<adjmat> loads[3];
     for (int i = 0; i < 3; ++i) {
-        if (!ifiles[i].is_open()) {
-            std::string msg(argv[i + 1]);
-            throw std::runtime_error(msg + ": no such file");
-        }
+        loads[i] = std::async(std::launch::async, [fname = string(argv[i])] {
+            std::ifstream ifile(fname, std::ios::binary);
+            if (!ifile.is_open()) {
+                throw std::runtime_error(fname + ": no such file");
+            }
+            // matrices saved with adjmat::save are copied straight from a
+            // mapping of the file. the engines update their matrices in
+            // place, so that one copy is still made.
+            char magic[sizeof(adjmat_magic)] = {};
+            ifile.read(magic, sizeof(magic));
+            ifile.clear();
+            ifile.seekg(0);
+            if (std::equal(magic, magic + sizeof(magic), adjmat_magic)) {
+                return mapped_adjmat(fname).to_adjmat();
+            }
+            adjmat mat;
+            ifile >> mat;
+            return mat;
+        });
     }
 
+    // wait for every load before reporting so no reader outlives main.
     adjmat mats[3];
+    std::exception_ptr err;
     for (int i = 0; i < 3; ++i) {
-        ifiles[i] >> mats[i];
+        try {
+            mats[i] = loads[i].get();
+        }
+        catch (...) {
+            if (!err) {
+                err = std::current_exception();
+            }
+        }
+    }
+    if (err) {
+        std::rethrow_exception(err);
+    }
+
+    for (int i = 1; i < 3; ++i) {
+        if (mats[i].dim() != mats[0].dim()) {
+            throw std::runtime_error(string(argv[i]) + ": expected " +
+                                     std::to_string(mats[0].dim()) + "x" +
+                                     std::to_string(mats[0].dim()) +
+                                     " matrix");
+        }
     }
 
-    return exact0paths(mats[0], mats[1], mats[2]);
+    return exact0paths(mats[0], mats[1], mats[2], opts);
 }
 
-static constexpr uint8_t itact = 0b01;
-static constexpr uint8_t csgf = 0b10;
+// parses a non-negative count
+static unsigned parse_count(const char* arg)
+{
+    unsigned n = 0;
+    std::string_view s(arg);
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), n);
+    if (ec != std::errc() || ptr != s.data() + s.size()) {
+        throw std::runtime_error("invalid count '" + string(s) + "'");
+    }
+    return n;
+}
 
-int main(int argc, char** argv)
+static unsigned parse_threads(const char* arg)
+{
+    unsigned n = parse_count(arg);
+    if (n == 0) {
+        throw std::runtime_error("invalid thread count '0'");
+    }
+    return n;
+}
+
+// inclusive range of vertex labels
+struct label_range {
+    int lo = std::numeric_limits<int>::min();
+    int hi = std::numeric_limits<int>::max();
+};
+
+// parses `a:b`, `a:`, `:b` or a single label `a`.
+static label_range parse_range(const char* arg)
+{
+    std::string_view s(arg);
+    auto bad = [&] {
+        return std::runtime_error("invalid label range '" + string(s) + "'");
+    };
+    auto label = [&](std::string_view part, int& out) {
+        auto [ptr, ec] =
+            std::from_chars(part.data(), part.data() + part.size(), out);
+        if (ec != std::errc() || ptr != part.data() + part.size()) {
+            throw bad();
+        }
+    };
+
+    label_range range;
+    auto colon = s.find(':');
+    if (colon == s.npos) {
+        label(s, range.lo);
+        range.hi = range.lo;
+        return range;
+    }
+    if (colon != 0) {
+        label(s.substr(0, colon), range.lo);
+    }
+    if (colon != s.size() - 1) {
+        label(s.substr(colon + 1), range.hi);
+    }
+    if (range.lo > range.hi) {
+        throw bad();
+    }
+    return range;
+}
+
+// the labels that fall within `range`
+static std::vector<int> select_labels(const std::vector<int>& labels,
+                                      const label_range& range)
+{
+    auto lo = std::ranges::lower_bound(labels, range.lo);
+    auto hi = std::ranges::upper_bound(labels, range.hi);
+    if (lo >= hi) {
+        throw std::runtime_error("no vertices in label range");
+    }
+    return {lo, hi};
+}
+
+// reports sweeps on stderr, at most about once a second plus the last one.
+static std::function<void(const sweep_stats&)> progress_reporter()
+{
+    using clock = std::chrono::steady_clock;
+    return [last = clock::time_point()](const sweep_stats& stats) mutable {
+        auto now = clock::now();
+        if (now - last >= std::chrono::seconds(1) ||
+            stats.sweep == stats.sweeps) {
+            report_sweep(std::cerr, stats);
+            last = now;
+        }
+    };
+}
+
+// runs exact0paths on an edge set, consulting the result cache if one is given
+static adjmat solve(const edge_set& edges,
+                    const std::optional<result_cache>& cache,
+                    const path_options& opts)
+{
+    if (!cache) {
+        return exact0paths(edges, opts);
+    }
+    if (auto hit = cache->load(edges)) {
+        return std::move(*hit);
+    }
+    adjmat result = exact0paths(edges, opts);
+    cache->store(edges, result);
+    return result;
+}
+
+static constexpr uint8_t itact = 0b0001;
+static constexpr uint8_t csgf = 0b0010;
+static constexpr uint8_t csgbf = 0b0100;
+static constexpr uint8_t compf = 0b1000;
+static constexpr uint8_t genf = 0b10000;
+
+// backs every matrix allocated from here on according to `mode`. the
+// resource lives to the end of the program, past any matrix using it.
+static void use_hugepages(hugepage_mode mode)
+{
+    static std::optional<hugepage_resource> resource;
+    if (mode == hugepage_mode::off || resource) {
+        return;
+    }
+    resource.emplace(mode);
+    std::pmr::set_default_resource(&*resource);
+}
+
+// long-only options are given values past the range of short option chars.
+enum : int {
+    opt_compile = 256,
+    opt_cache,
+    opt_format,
+    opt_rows,
+    opt_cols,
+    opt_save,
+    opt_checkpoint,
+    opt_checkpoint_every,
+    opt_resume,
+    opt_progress,
+    opt_generate,
+    opt_engine,
+    opt_numa,
+    opt_hugepages
+};
+
+static constexpr option long_opts[] = {
+    {"compile", no_argument, nullptr, opt_compile},
+    {"cache", required_argument, nullptr, opt_cache},
+    {"format", required_argument, nullptr, opt_format},
+    {"rows", required_argument, nullptr, opt_rows},
+    {"cols", required_argument, nullptr, opt_cols},
+    {"save", required_argument, nullptr, opt_save},
+    {"checkpoint", required_argument, nullptr, opt_checkpoint},
+    {"checkpoint-every", required_argument, nullptr, opt_checkpoint_every},
+    {"resume", no_argument, nullptr, opt_resume},
+    {"progress", no_argument, nullptr, opt_progress},
+    {"generate", required_argument, nullptr, opt_generate},
+    {"engine", required_argument, nullptr, opt_engine},
+    {"numa", no_argument, nullptr, opt_numa},
+    {"hugepages", required_argument, nullptr, opt_hugepages},
+    {nullptr, 0, nullptr, 0},
+};
+
+// main, callable from the tests
+static int lab5_main(int argc, char** argv)
 try {
     uint8_t flags = 0;
     std::string csgfname;
+    std::string genspec;
+    std::optional<std::string> cachedir;
+    out_format fmt = out_format::box;
+    unsigned nthreads = 1;
+    std::optional<label_range> rows, cols;
+    std::optional<std::string> savename;
+    path_options popts;
     int opt;
 
-    while ((opt = getopt(argc, argv, "ic:")) != -1) {
+    while ((opt = getopt_long(argc, argv, "ic:b:j:", long_opts, nullptr)) !=
+           -1) {
         switch (opt) {
         case 'i':
             flags |= itact;
@@ -62,34 +304,169 @@ try {
             flags |= csgf;
             csgfname = std::string(optarg);
             break;
+        case 'b':
+            flags |= csgbf;
+            csgfname = std::string(optarg);
+            break;
+        case 'j':
+            nthreads = parse_threads(optarg);
+            popts.nthreads = nthreads;
+            break;
+        case opt_compile:
+            flags |= compf;
+            break;
+        case opt_cache:
+            cachedir = std::string(optarg);
+            break;
+        case opt_format:
+            fmt = parse_format(optarg);
+            break;
+        case opt_rows:
+            rows = parse_range(optarg);
+            break;
+        case opt_cols:
+            cols = parse_range(optarg);
+            break;
+        case opt_save:
+            savename = std::string(optarg);
+            break;
+        case opt_checkpoint:
+            popts.checkpoint = std::string(optarg);
+            break;
+        case opt_checkpoint_every:
+            popts.checkpoint_every = std::chrono::seconds(parse_count(optarg));
+            break;
+        case opt_resume:
+            popts.resume = true;
+            break;
+        case opt_progress:
+            popts.on_sweep = progress_reporter();
+            break;
+        case opt_generate:
+            flags |= genf;
+            genspec = std::string(optarg);
+            break;
+        case opt_engine:
+            popts.engine = parse_engine(optarg);
+            break;
+        case opt_numa:
+            popts.numa = true;
+            break;
+        case opt_hugepages:
+            use_hugepages(parse_hugepages(optarg));
+            break;
         case '?':
         default:
             throw std::runtime_error("invalid arguments");
         }
     }
 
-    std::map<std::pair<int, int>, int> edges;
-    adjmat result;
+    // the run's edges, matrices and engine temporaries, freed together.
+    // after option parsing, so that it takes its blocks from --hugepages.
+    run_arena arena;
+    popts.memory = &arena;
+    edge_set edges(&arena);
+    adjmat result(&arena);
 
     int nargs = argc - optind;
 
-    if (flags == 3 || (!flags && nargs != 3) || (flags && nargs)) {
+    // input modes are mutually exclusive
+    if (flags & (flags - 1)) {
+        throw std::runtime_error("invalid arguments");
+    }
+    if ((flags & compf && nargs != 2) || (!flags && nargs != 3) ||
+        (flags & ~compf && nargs)) {
         throw std::runtime_error("invalid arguments");
     }
 
-    if (flags & itact) {
-        edges = csg::parse(std::cin);
-        result = exact0paths(edges);
+    std::optional<result_cache> cache;
+    if (cachedir) {
+        cache.emplace(*cachedir);
+    }
+
+    if (popts.resume && popts.checkpoint.empty()) {
+        throw std::runtime_error("--resume requires --checkpoint");
+    }
+
+    if (flags & compf) {
+        csg::compile(csg::parse(string(argv[optind])), argv[optind + 1]);
+        return 0;
+    }
+    else if (flags & genf) {
+        gen::write(std::cout, gen::from_spec(genspec));
+        return 0;
+    }
+
+    // a row window on a graph input only needs the rows it shows, unless the
+    // full result is wanted for the cache or --save.
+    bool lazy = rows && !cache && !savename;
+    bool graph = flags & (itact | csgf | csgbf);
+    // the cfl engine can write sparse output without ever building the n²
+    // result matrix, which is what lets it take very large graphs.
+    bool direct = popts.engine == path_engine::cfl &&
+                  fmt == out_format::sparse && !rows && !cols && !savename &&
+                  !cache;
+
+    if (flags & csgbf) {
+        csg::compiled_graph cgraph(csgfname);
+        // the cache is keyed by edge set, so only rebuild it when needed.
+        if (cache || lazy || direct) {
+            edges = cgraph.edge_map(&arena);
+        }
+        else {
+            result = exact0paths(cgraph.to_adjmat(), popts);
+            graph = false;
+        }
+    }
+    else if (flags & itact) {
+        edges = csg::parse(std::cin, &arena);
     }
     else if (flags & csgf) {
-        edges = csg::parse(csgfname);
-        result = exact0paths(edges);
+        edges = csg::parse(csgfname, &arena);
+    }
+    else {
+        result = do_3file_input(argv + optind, popts);
+    }
+
+    // every vertex of the input, in label order
+    std::vector<int> labels;
+    auto keys = [&](const vertex_map& vmap) {
+        auto k = vmap | std::views::keys;
+        labels.assign(k.begin(), k.end());
+    };
+
+    if (graph && direct) {
+        cfl0paths(edges, popts).write_sparse(std::cout);
+        return 0;
+    }
+    else if (graph) {
+        keys(adjmat::gen_vmap(edges, &arena));
+        if (lazy) {
+            auto srcs = select_labels(labels, *rows);
+            result =
+                exact0paths_from(edges, {srcs.begin(), srcs.end()}, popts);
+        }
+        else {
+            result = solve(edges, cache, popts);
+        }
     }
     else {
-        result = do_3file_input(argv + optind);
+        keys(result.vmap());
+    }
+
+    if (savename) {
+        result.save(*savename);
     }
 
-    std::cout << result;
+    if (rows || cols) {
+        adjview view(result,
+                     rows ? select_labels(labels, *rows) : labels,
+                     cols ? select_labels(labels, *cols) : labels);
+        write_result(std::cout, view, fmt, nthreads);
+    }
+    else {
+        write_result(std::cout, result, fmt, nthreads);
+    }
     return 0;
 }
 catch (const csg::parse_error& e) {
@@ -107,8 +484,87 @@ catch (...) {
     return 1;
 }
 
+#ifndef TESTING
+int main(int argc, char** argv)
+{
+    return lab5_main(argc, argv);
+}
 #else
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest.h"
 
+#include <filesystem>
+#include <sstream>
+
+// runs lab5 with `args`, discarding what it prints
+static int run_lab5(std::vector<string> args)
+{
+    std::vector<char*> argv{const_cast<char*>("lab5.out")};
+    for (auto& arg : args) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+    optind = 0; // getopt starts over
+
+    std::ostringstream out;
+    auto* old = std::cout.rdbuf(out.rdbuf());
+    int status = lab5_main(int(argv.size() - 1), argv.data());
+    std::cout.rdbuf(old);
+    return status;
+}
+
+TEST_CASE("lab5 --save")
+{
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / "lab5-save-test";
+    fs::create_directories(dir);
+    string graph = dir / "g.csg", whole = dir / "whole.bin",
+           window = dir / "window.bin";
+    // vertex 3 has no out-edges, so its rows alone would reach nothing
+    std::ofstream(graph) << "1+2-3\n1-4+5\n";
+
+    CHECK(run_lab5({"-c", graph, "--save", whole}) == 0);
+    CHECK(run_lab5({"-c", graph, "--rows", "3:3", "--save", window}) == 0);
+
+    // the window only changes what is shown, not what is saved
+    ifstream a(whole, std::ios::binary), b(window, std::ios::binary);
+    adjmat saved = adjmat::load(a);
+    CHECK(saved.dim() == 5);
+    CHECK(adjmat::load(b) == saved);
+    fs::remove_all(dir);
+}
+
+TEST_CASE("lab5 three saved matrices")
+{
+    namespace fs = std::filesystem;
+    auto dir = fs::temp_directory_path() / "lab5-3file-test";
+    fs::create_directories(dir);
+    const char* texts[3] = {"2 -1 2\n2 2 2\n2 2 2\n",
+                            "2 2 2\n2 2 2\n2 2 2\n",
+                            "2 2 2\n2 2 1\n2 2 2\n"};
+    std::vector<string> text_args, saved_args;
+    for (int i = 0; i < 3; ++i) {
+        string text = dir / ("m" + std::to_string(i) + ".txt");
+        string bin = dir / ("m" + std::to_string(i) + ".bin");
+        std::ofstream(text) << texts[i];
+        std::istringstream in(texts[i]);
+        adjmat mat;
+        in >> mat;
+        mat.save(bin);
+        text_args.push_back(text);
+        saved_args.push_back(bin);
+    }
+    string from_text = dir / "text.out", from_saved = dir / "saved.out";
+    text_args.insert(text_args.end(), {"--save", from_text});
+    saved_args.insert(saved_args.end(), {"--save", from_saved});
+
+    // saved matrices are read through a mapping, to the same result
+    CHECK(run_lab5(text_args) == 0);
+    CHECK(run_lab5(saved_args) == 0);
+    CHECK(adjmat::load(from_saved) == adjmat::load(from_text));
+    CHECK(adjmat::load(from_saved).vmap() == adjmat::load(from_text).vmap());
+    fs::remove_all(dir);
+}
+
+#endif
 #endif
@@ -0,0 +1,65 @@
+#include "mapfile.hpp"
+
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+mapped_file::mapped_file(const std::string& fname) : _name{fname}
+{
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error(fname + ": no such file");
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == -1) {
+        int err = errno;
+        ::close(fd);
+        throw std::system_error(err, std::generic_category(), fname);
+    }
+    _size = st.st_size;
+    // mmap rejects zero-length mappings; an empty file maps to nothing.
+    if (_size != 0) {
+        void* p = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            throw std::system_error(err, std::generic_category(), fname);
+        }
+        _data = static_cast<const std::byte*>(p);
+    }
+    // the mapping stays valid after the descriptor is closed.
+    ::close(fd);
+}
+
+mapped_file::~mapped_file()
+{
+    if (_data) {
+        ::munmap(const_cast<std::byte*>(_data), _size);
+    }
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept
+    : _name{std::move(other._name)},
+      _data{std::exchange(other._data, nullptr)},
+      _size{std::exchange(other._size, 0)}
+{
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept
+{
+    if (this != &other) {
+        if (_data) {
+            ::munmap(const_cast<std::byte*>(_data), _size);
+        }
+        _name = std::move(other._name);
+        _data = std::exchange(other._data, nullptr);
+        _size = std::exchange(other._size, 0);
+    }
+    return *this;
+}
@@ -0,0 +1,28 @@
+#ifndef MAPFILE_HPP
+#define MAPFILE_HPP
+
+#include <string>
+#include <cstddef>
+
+// read-only memory mapping of an entire file. unmapped on destruction.
+class mapped_file {
+public:
+    explicit mapped_file(const std::string& fname);
+    ~mapped_file();
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator=(mapped_file&& other) noexcept;
+
+    const std::byte* data() const { return _data; }
+    size_t size() const { return _size; }
+    const std::string& name() const { return _name; }
+
+private:
+    std::string _name;
+    const std::byte* _data = nullptr;
+    size_t _size = 0;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "matrix.hpp"
 #include "tcolor.hpp"
+#include "render.hpp"
 
 #include <algorithm>
 #include <iostream>
@@ -8,47 +9,50 @@
 #include <ranges>
 #include <iomanip>
 #include <string_view>
+#include <charconv>
+#include <stdexcept>
+#include <cstring>
+#include <fstream>
+#include <limits>
 
 using std::ostream, std::istream;
 using std::string, std::string_view;
 
-std::set<int>
-adjmat::get_vertices(const std::map<std::pair<int, int>, int>& edges)
+vertex_map adjmat::default_vmap(size_t dim, std::pmr::memory_resource* mem)
 {
-    std::set<int> vertices;
-    for (const auto& [v1, v2] : edges | std::views::keys) {
-        vertices.insert({v1, v2});
-    }
-    return vertices;
-}
-
-std::map<int, size_t> adjmat::default_vmap(size_t dim)
-{
-    std::map<int, size_t> vmap;
+    vertex_map vmap(mem);
     for (auto i = 0u; i < dim; ++i) {
         vmap.insert({i, i});
     }
     return vmap;
 }
 
-std::map<int, size_t>
-adjmat::gen_vmap(const std::map<std::pair<int, int>, int>& edges)
+vertex_map adjmat::gen_vmap(const edge_set& edges,
+                            std::pmr::memory_resource* mem)
 {
-    std::map<int, size_t> vmap;
-    auto vertices = get_vertices(edges);
-    size_t i = 0;
-    for (const auto& vert : vertices) {
-        vmap.insert({vert, i});
-        ++i;
+    // every endpoint, sorted, without repeats
+    std::pmr::vector<int> vertices(mem);
+    vertices.reserve(2 * edges.size());
+    for (const auto& [v1, v2] : edges | std::views::keys) {
+        vertices.push_back(v1);
+        vertices.push_back(v2);
+    }
+    std::ranges::sort(vertices);
+    vertices.erase(std::unique(vertices.begin(), vertices.end()),
+                   vertices.end());
+
+    vertex_map vmap(mem);
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        vmap.emplace_hint(vmap.end(), vertices[i], i);
     }
     return vmap;
 }
 
-adjmat::adjmat(const std::map<std::pair<int, int>, int>& edges)
-    : _vmap{gen_vmap(edges)}
+adjmat::adjmat(const edge_set& edges, std::pmr::memory_resource* mem)
+    : _vmap{gen_vmap(edges, mem)}, _data(mem)
 {
     _dim = _vmap.size();
-    _data = std::vector<int>(_dim * _dim, _inf);
+    _data.assign(_dim * _dim, _inf);
     for (const auto& [vertices, wt] : edges) {
         auto& [v1, v2] = vertices;
         (*this)[{v1, v2}] = wt;
@@ -107,131 +111,473 @@ static constexpr string_view VBAR = "\u2502";
 static constexpr string_view HBAR = "\u2500";
 static constexpr string_view CROSS = "\u253c";
 
-// my matrices bring all the boys to the yard.
-// yes. this code is the stuff of nightmares.
-// but it works.
-ostream& operator<<(ostream& os, const adjmat& self)
+std::pair<int, int> adjmat::range() const
 {
-    auto wide1 = std::to_string(self._vmap.rbegin()->first).size();
-    auto wide2 = std::to_string(*std::ranges::max_element(self._data)).size();
-    // minus sign
-    auto wide3 = std::to_string(*std::ranges::min_element(self._data)).size();
-    auto wide = std::max({wide1, wide2, wide3, 2ul});
+    if (_data.empty()) {
+        return {0, 0};
+    }
+    auto [lo, hi] = std::ranges::minmax(_data);
+    return {lo, hi};
+}
 
-    // n=`wide` DHBARs
-    // cant use string(wide, DHBAR) because DHBAR is multibyte
-    // and I need to keep string<CharT> consistent
-    string hdwide;
-    for (auto i = 0u; i < wide; ++i) {
-        hdwide += DHBAR;
+// n copies of a (possibly multibyte) box drawing character.
+static string repeat(string_view s, size_t n)
+{
+    string out;
+    out.reserve(s.size() * n);
+    for (auto i = 0u; i < n; ++i) {
+        out += s;
     }
+    return out;
+}
 
-    // top line
-    os << DDOWNRIGHT << hdwide << DHDDOWN;
-    for (auto i = 0u; i < self.dim() - 1; ++i) {
-        os << hdwide << DHDOWN;
+// a line of the form `left` fill `first` (fill `inner`)... fill `right`
+// where fill is `wide` copies of `bar`, with one fill per column after the
+// first.
+static string rule(string_view left, string_view first, string_view inner,
+                   string_view right, string_view bar, size_t wide, size_t dim)
+{
+    string fill = repeat(bar, wide);
+    string out;
+    out.reserve((fill.size() + 3) * (dim + 1) + right.size() + 1);
+    out += left;
+    out += fill;
+    out += first;
+    for (auto i = 0u; i < dim - 1; ++i) {
+        out += fill;
+        out += inner;
     }
-    os << hdwide << DDOWNLEFT << '\n';
+    out += fill;
+    out += right;
+    out += '\n';
+    return out;
+}
 
-    // vertex column label line
-    os << DVBAR << BOLD << "𝑽" << RESET << string(wide - 1, ' ') << DVBAR;
-    auto verts = self._vmap | std::views::keys;
-    for (auto it = verts.begin(); it != std::prev(verts.end()); ++it) {
-        os << BOLD << std::setw(wide) << *it << RESET << VBAR;
+adjview::adjview(const adjmat& mat) : _mat{&mat}, _whole{true}
+{
+    auto verts = mat.vmap() | std::views::keys;
+    _rlabels.assign(verts.begin(), verts.end());
+    _clabels = _rlabels;
+    for (const auto& [label, idx] : mat.vmap()) {
+        _rowp.push_back(mat.row(idx));
+        _cidx.push_back(idx);
     }
-    os << BOLD << std::setw(wide) << verts.back() << RESET << DVBAR << '\n';
+}
 
-    // third line
-    os << DVDRIGHT << hdwide << DCROSS;
-    string hsep = hdwide;
-    for (auto i = 0u; i < wide * (self.dim() - 1) + self.dim() - 1; ++i) {
-        if (i % (wide + 1) == 0) {
-            hsep += DHSV;
+adjview::adjview(const adjmat& mat, std::vector<int> rows,
+                 std::vector<int> cols)
+    : _mat{&mat}, _rlabels{std::move(rows)}, _clabels{std::move(cols)}
+{
+    const auto& vm = mat.vmap();
+    for (int label : _rlabels) {
+        auto it = vm.find(label);
+        _rowp.push_back(it == vm.end() ? nullptr : mat.row(it->second));
+    }
+    for (int label : _clabels) {
+        auto it = vm.find(label);
+        _cidx.push_back(it == vm.end() ? -1 : ptrdiff_t(it->second));
+    }
+}
+
+std::pair<int, int> adjview::range() const
+{
+    if (_whole) {
+        return _mat->range();
+    }
+    if (rows() == 0 || cols() == 0) {
+        return {0, 0};
+    }
+    int lo = (*this)(0, 0);
+    int hi = lo;
+    for (auto r = 0u; r < rows(); ++r) {
+        for (auto c = 0u; c < cols(); ++c) {
+            int val = (*this)(r, c);
+            lo = std::min(lo, val);
+            hi = std::max(hi, val);
         }
-        else {
-            hsep += DHBAR;
+    }
+    return {lo, hi};
+}
+
+// my matrices bring all the boys to the yard.
+//
+// every line that doesn't depend on cell values is built once up front; rows
+// are then formatted into a shared buffer and written out in large blocks.
+void write_table(ostream& os, const adjview& view, unsigned nthreads)
+{
+    size_t nrows = view.rows();
+    size_t ncols = view.cols();
+    if (nrows == 0 || ncols == 0) {
+        throw std::runtime_error("nothing to draw: empty view");
+    }
+    const auto& rlabels = view.row_labels();
+    const auto& clabels = view.col_labels();
+
+    // the only pass over the cells besides formatting them.
+    auto [lo, hi] = view.range();
+    // the longest label, which need not be the last: labels may be negative
+    // and views may list them in any order.
+    size_t wide1 = 0;
+    for (const auto* labels : {&rlabels, &clabels}) {
+        for (int label : *labels) {
+            wide1 = std::max(wide1, std::to_string(label).size());
         }
     }
-    hsep += DVDLEFT;
-    os << hsep << '\n';
+    auto wide2 = std::to_string(hi).size();
+    // minus sign
+    auto wide3 = std::to_string(lo).size();
+    auto wide = std::max({wide1, wide2, wide3, 2ul});
 
-    // string(wide, HBAR)
-    string hswide;
-    for (auto i = 0u; i < wide; ++i) {
-        hswide += HBAR;
+    // top line
+    string line =
+        rule(DDOWNRIGHT, DHDDOWN, DHDOWN, DDOWNLEFT, DHBAR, wide, ncols);
+    os.write(line.data(), line.size());
+
+    // vertex column label line
+    line = DVBAR;
+    line += BOLD "𝑽" RESET;
+    line.append(wide - 1, ' ');
+    line += DVBAR;
+    for (auto c = 0u; c < ncols; ++c) {
+        line += BOLD;
+        append_int(line, clabels[c], wide);
+        line += RESET;
+        line += c == ncols - 1 ? DVBAR : VBAR;
     }
+    line += '\n';
+    os.write(line.data(), line.size());
+
+    // third line
+    line = rule(DVDRIGHT, DCROSS, DHSV, DVDLEFT, DHBAR, wide, ncols);
+    os.write(line.data(), line.size());
+
+    // infinite cells are always `wide - 1` spaces and the symbol. the symbol
+    // is multibyte, so setw never padded it any further.
+    string infcell = string(wide - 1, ' ') + "∞";
+    string sep = rule(DVSRIGHT, DVSH, CROSS, DVSLEFT, HBAR, wide, ncols);
+    int inf = view.infmap();
 
     // row lines
-    auto vx = (self._vmap | std::views::keys).begin();
-    for (auto r = 0u; r < self.dim(); ++r) {
-        // vertex label
-        os << DVBAR << BOLD << std::setw(wide) << std::left << *vx++ << RESET
-           << DVBAR << std::right;
-        // adjacencies
-        string val;
-        for (auto c = 0u; c < self.dim() - 1; ++c) {
-            if (self._inf == self(r, c)) {
-                val = string(wide - 1, ' ') + "∞";
+    render_rows(os, nrows, [&](string& buf, size_t r0, size_t r1) {
+        for (auto r = r0; r < r1; ++r) {
+            // vertex label, left aligned
+            buf += DVBAR;
+            buf += BOLD;
+            size_t start = buf.size();
+            append_int(buf, rlabels[r], 0);
+            buf.append(wide - std::min(wide, buf.size() - start), ' ');
+            buf += RESET;
+            buf += DVBAR;
+
+            // adjacencies
+            for (auto c = 0u; c < ncols; ++c) {
+                int val = view(r, c);
+                if (val == 0) {
+                    buf += MAGENTA;
+                }
+                if (val == inf) {
+                    buf += infcell;
+                }
+                else {
+                    append_int(buf, val, wide);
+                }
+                buf += RESET;
+                buf += c == ncols - 1 ? DVBAR : VBAR;
+            }
+            buf += '\n';
+
+            // separator
+            if (r != nrows - 1) {
+                buf += sep;
+            }
+        }
+    }, nthreads);
+
+    // final line
+    line = rule(DUPRIGHT, DHDUP, DHUP, DUPLEFT, DHBAR, wide, ncols);
+    os.write(line.data(), line.size());
+}
+
+ostream& operator<<(ostream& os, const adjmat& self)
+{
+    write_table(os, self, 1);
+    return os;
+}
+
+// reads a whitespace-separated square matrix, one row per line. the first
+// non-blank row fixes the dimension and values are parsed straight into the
+// flat cell buffer.
+istream& operator>>(istream& is, adjmat& self)
+{
+    auto is_blank = [](char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\v' ||
+               ch == '\f';
+    };
+
+    // parses the line at `p` into `out`, returning the number of values read.
+    // the line must end before `end`, with a newline or at `end` itself.
+    const char* p = nullptr;
+    const char* end = nullptr;
+    auto read_row = [&](auto& out) {
+        size_t n = 0;
+        while (p != end && *p != '\n') {
+            if (is_blank(*p)) {
+                ++p;
+                continue;
             }
-            else {
-                val = std::to_string(self(r, c));
+            // operator>>(int&) accepted an explicit plus sign, so do we.
+            if (*p == '+') {
+                ++p;
             }
-            if (self(r, c) == 0) {
-                os << MAGENTA;
+            int val;
+            auto [ptr, ec] = std::from_chars(p, end, val);
+            if (ec != std::errc()) {
+                throw std::runtime_error("invalid matrix entry");
             }
-            os << std::setw(wide) << val << RESET << VBAR;
+            p = ptr;
+            out.push_back(val);
+            ++n;
         }
-        if (self._inf == self(r, self.dim() - 1)) {
-            val = string(wide - 1, ' ') + "∞";
+        if (p != end) {
+            ++p; // newline
         }
-        else {
-            val = std::to_string(self(r, self.dim() - 1));
+        return n;
+    };
+
+    adjmat mat;
+    size_t rows = 0;
+    // read in large blocks so parsing never touches iostreams. only whole
+    // lines are parsed; the partial line at the end of a block is kept and
+    // finished by the next, so no more than a block and a line are held.
+    string buf;
+    char block[1 << 16];
+    for (bool last = false; !last;) {
+        is.read(block, sizeof(block));
+        size_t got = is.gcount();
+        last = got < sizeof(block);
+        buf.append(block, got);
+
+        size_t whole = buf.size();
+        if (!last) {
+            // only this block can hold a newline
+            size_t nl = std::string_view(block, got).rfind('\n');
+            whole = nl == string::npos ? 0 : buf.size() - got + nl + 1;
         }
-        if (self(r, self.dim() - 1) == 0) {
-            os << MAGENTA;
+        p = buf.data();
+        end = p + whole;
+        while (p != end) {
+            size_t n = read_row(mat._data);
+            if (n == 0) {
+                continue; // blank line
+            }
+            if (rows == 0) {
+                mat._dim = n;
+                mat._data.reserve(n * n);
+            }
+            else if (n != mat._dim) {
+                throw std::logic_error("matrix dimension/data mismatch");
+            }
+            ++rows;
         }
+        buf.erase(0, whole);
+    }
+    if (rows != mat._dim) {
+        throw std::logic_error("matrix dimension/data mismatch");
+    }
+    mat._vmap = adjmat::default_vmap(mat._dim);
 
-        os << std::setw(wide) << val << RESET << DVBAR << '\n';
-        // separator
-        if (r != self.dim() - 1) {
-            os << DVSRIGHT << hswide << DVSH;
-            for (auto c = 0u; c < self.dim() - 1; ++c) {
-                os << hswide << CROSS;
-            }
-            os << hswide << DVSLEFT << '\n';
+    self = std::move(mat);
+    return is;
+}
+
+static constexpr uint32_t adjmat_version = 1;
+static constexpr uint32_t adjmat_bom = 0x01020304;
+
+// checks a header read from `fname` and returns the size of the label and
+// cell blocks that follow it.
+static size_t check_header(const adjmat_header& hdr, const string& fname)
+{
+    if (std::memcmp(hdr.magic, adjmat_magic, sizeof(hdr.magic)) != 0) {
+        throw std::runtime_error(fname + ": not a saved matrix");
+    }
+    if (hdr.bom != adjmat_bom) {
+        throw std::runtime_error(fname + ": saved matrix has foreign byte order");
+    }
+    if (hdr.version != adjmat_version) {
+        throw std::runtime_error(fname + ": unsupported matrix version " +
+                                 std::to_string(hdr.version));
+    }
+    if (hdr.elem != sizeof(int)) {
+        throw std::runtime_error(fname + ": unsupported matrix element size");
+    }
+    // a label and a row of cells per vertex, dim * (dim + 1) 4-byte words,
+    // so that a corrupt dim is reported rather than wrapping around.
+    constexpr uint64_t words = std::numeric_limits<size_t>::max() / sizeof(int);
+    if (hdr.dim >= words || (hdr.dim && hdr.dim + 1 > words / hdr.dim)) {
+        throw std::runtime_error(fname + ": saved matrix too large");
+    }
+    return hdr.dim * sizeof(int32_t) + hdr.dim * hdr.dim * sizeof(int);
+}
+
+// bytes left in `is`, or -1 if it can't seek to tell.
+static std::streamoff remaining(istream& is)
+{
+    auto here = is.tellg();
+    if (here < 0 || !is.seekg(0, std::ios::end)) {
+        is.clear();
+        return -1;
+    }
+    auto end = is.tellg();
+    is.seekg(here);
+    return end - here;
+}
+
+// appends `count` values read from `is` to `out` a block at a time, so a
+// stream shorter than it claims fails before the whole of `count` is
+// allocated. false if the stream ends first.
+template <typename T, typename Alloc>
+static bool read_values(istream& is, std::vector<T, Alloc>& out, size_t count)
+{
+    constexpr size_t block = (size_t(1) << 20) / sizeof(T);
+    while (count) {
+        size_t n = std::min(count, block);
+        size_t at = out.size();
+        out.resize(at + n);
+        if (!is.read(reinterpret_cast<char*>(out.data() + at), n * sizeof(T))) {
+            return false;
         }
+        count -= n;
     }
+    return true;
+}
 
-    // final line
-    os << DUPRIGHT << hdwide << DHDUP;
-    for (auto i = 0u; i < self.dim() - 1; ++i) {
-        os << hdwide << DHUP;
+void adjmat::save(ostream& os) const
+{
+    adjmat_header hdr{};
+    std::memcpy(hdr.magic, adjmat_magic, sizeof(hdr.magic));
+    hdr.version = adjmat_version;
+    hdr.bom = adjmat_bom;
+    hdr.elem = sizeof(int);
+    hdr.dim = _dim;
+    hdr.inf = _inf;
+
+    if (_vmap.size() != _dim) {
+        throw std::logic_error("matrix vertex map/dimension mismatch");
+    }
+    std::vector<int32_t> labels(_dim);
+    for (const auto& [label, idx] : _vmap) {
+        labels.at(idx) = label;
     }
-    os << hdwide << DUPLEFT << '\n';
 
-    return os;
+    os.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+    os.write(reinterpret_cast<const char*>(labels.data()),
+             labels.size() * sizeof(int32_t));
+    os.write(reinterpret_cast<const char*>(_data.data()),
+             _data.size() * sizeof(int));
+    if (!os) {
+        throw std::runtime_error("failed to write matrix");
+    }
 }
 
-istream& operator>>(istream& is, adjmat& self)
+void adjmat::save(const string& fname) const
 {
-    std::vector<std::vector<int>> vals;
+    std::ofstream ofile(fname, std::ios::binary | std::ios::trunc);
+    if (!ofile.is_open()) {
+        throw std::runtime_error(fname + ": cannot open for writing");
+    }
+    save(ofile);
+}
 
-    for (string line; std::getline(is, line);) {
-        std::istringstream iss{std::move(line)};
-        std::vector<int> linevals;
-        for (int i; iss >> i;) {
-            linevals.push_back(i);
+adjmat adjmat::load(istream& is)
+{
+    adjmat_header hdr;
+    if (!is.read(reinterpret_cast<char*>(&hdr), sizeof(hdr))) {
+        throw std::runtime_error("<istream>: not a saved matrix");
+    }
+    size_t bytes = check_header(hdr, "<istream>");
+    // a seekable stream is checked for the whole matrix up front; any other
+    // is read in blocks and fails at its end.
+    auto left = remaining(is);
+    if (left >= 0 && uint64_t(left) < bytes) {
+        throw std::runtime_error("<istream>: truncated matrix");
+    }
+
+    std::vector<int32_t> labels;
+    adjmat mat;
+    mat._dim = hdr.dim;
+    if (left >= 0) {
+        labels.reserve(hdr.dim);
+        mat._data.reserve(hdr.dim * hdr.dim);
+    }
+    if (!read_values(is, labels, hdr.dim) ||
+        !read_values(is, mat._data, hdr.dim * hdr.dim)) {
+        throw std::runtime_error("<istream>: truncated matrix");
+    }
+
+    mat._vmap.clear();
+    for (size_t i = 0; i < labels.size(); ++i) {
+        if (!mat._vmap.insert({labels[i], i}).second) {
+            throw std::runtime_error("<istream>: duplicate vertex label");
         }
-        vals.push_back(std::move(linevals));
     }
+    mat._inf = hdr.inf;
+    return mat;
+}
 
-    self = adjmat(vals); // move into
-    return is;
+adjmat adjmat::load(const string& fname)
+{
+    std::ifstream ifile(fname, std::ios::binary);
+    if (!ifile.is_open()) {
+        throw std::runtime_error(fname + ": no such file");
+    }
+    return load(ifile);
+}
+
+mapped_adjmat::mapped_adjmat(const string& fname) : _file{fname}
+{
+    adjmat_header hdr;
+    if (_file.size() < sizeof(hdr)) {
+        throw std::runtime_error(fname + ": not a saved matrix");
+    }
+    std::memcpy(&hdr, _file.data(), sizeof(hdr));
+    if (_file.size() != sizeof(hdr) + check_header(hdr, fname)) {
+        throw std::runtime_error(fname + ": truncated matrix");
+    }
+
+    _dim = hdr.dim;
+    _inf = hdr.inf;
+    // header and 4-byte labels keep the cells aligned in the mapping.
+    _labels = reinterpret_cast<const int32_t*>(_file.data() + sizeof(hdr));
+    _cells = reinterpret_cast<const int*>(_labels + _dim);
+
+    // a repeated label would leave vmap() short of dim() entries
+    if (vmap().size() != _dim) {
+        throw std::runtime_error(fname + ": duplicate vertex label");
+    }
+}
+
+vertex_map mapped_adjmat::vmap() const
+{
+    vertex_map vm;
+    for (size_t i = 0; i < _dim; ++i) {
+        vm.insert({_labels[i], i});
+    }
+    return vm;
+}
+
+adjmat mapped_adjmat::to_adjmat() const
+{
+    adjmat mat(_dim, 0);
+    std::copy(_cells, _cells + _dim * _dim, mat._data.begin());
+    mat.vmap(vmap());
+    mat.infmap(_inf);
+    return mat;
 }
 
 #ifdef TESTING
 #include "doctest.h"
 
+#include <filesystem>
 #include <sstream>
 
 TEST_CASE("adjmat")
@@ -245,11 +591,44 @@ TEST_CASE("adjmat")
         input >> m;
 
         CHECK(m == tmat);
+
+        std::istringstream padded("\t-1  +2 3\r\n\n4 5 6\n7 8 9\n\n");
+        adjmat tneg{{-1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+        padded >> m;
+        CHECK(m == tneg);
+
+        std::istringstream ragged("1 2 3\n4 5\n7 8 9");
+        CHECK_THROWS_AS(ragged >> m, std::logic_error);
+        std::istringstream tall("1 2\n3 4\n5 6");
+        CHECK_THROWS_AS(tall >> m, std::logic_error);
+        std::istringstream junk("1 x\n3 4");
+        CHECK_THROWS_AS(junk >> m, std::runtime_error);
+
+        // many blocks, so rows and numbers are split across them
+        adjmat big(300, 2);
+        std::string text;
+        for (size_t r = 0; r < 300; ++r) {
+            for (size_t c = 0; c < 300; ++c) {
+                if (r % 7 == c % 5) {
+                    big(r, c) = -12345;
+                }
+                text += std::to_string(big(r, c)) + ' ';
+            }
+            text += '\n';
+        }
+        std::istringstream blocks(text);
+        blocks >> m;
+        CHECK(m == big);
+
+        // a line longer than a block
+        std::istringstream wide("1 2" + std::string(100000, ' ') + "\n3 4");
+        wide >> m;
+        CHECK(m == adjmat{{1, 2}, {3, 4}});
     }
 
     SUBCASE("adjmat::adjmat(edges)")
     {
-        std::map<std::pair<int, int>, int> edges{
+        edge_set edges{
             {{1, 1}, 1}, {{2, 2}, 1}, {{3, 3}, 1}, {{4, 4}, 1}, {{5, 5}, 1}};
 
         adjmat tmat{{1, 2, 2, 2, 2},
@@ -281,6 +660,131 @@ TEST_CASE("adjmat")
         CHECK(tmat == adjmat(tvec, 3));
     }
 
+    SUBCASE("adjmat::range()")
+    {
+        adjmat tmat{{1, -2, 3}, {4, 5, 6}, {7, 8, -9}};
+        CHECK(tmat.range() == std::pair{-9, 8});
+        CHECK(adjmat().range() == std::pair{0, 0});
+    }
+
+    SUBCASE("adjview")
+    {
+        edge_set edges{{{1, 2}, 1}, {{2, 3}, -1}, {{3, 4}, 1}, {{1, 4}, -1}};
+        adjmat tmat(edges);
+
+        adjview whole(tmat);
+        CHECK(whole.rows() == 4);
+        CHECK(whole(0, 1) == 1);
+        CHECK(whole.range() == tmat.range());
+
+        // 7 isn't a vertex, so it reads as infinity
+        adjview part(tmat, {1, 7}, {4, 2});
+        CHECK(part(0, 0) == -1);
+        CHECK(part(0, 1) == 1);
+        CHECK(part(1, 0) == 2);
+        CHECK(part.range() == std::pair{-1, 2});
+
+        std::ostringstream full, drawn;
+        full << tmat;
+        write_table(drawn, whole, 1);
+        CHECK(drawn.str() == full.str());
+
+        // columns are as wide as the longest label wherever it is listed
+        std::ostringstream last, first;
+        write_table(last, adjview(tmat, {1, 123}, {2, 1}), 1);
+        write_table(first, adjview(tmat, {123, 1}, {2, 1}), 1);
+        auto top = [](const std::ostringstream& os) {
+            return os.str().substr(0, os.str().find('\n'));
+        };
+        CHECK(top(first) == top(last));
+        CHECK(first.str().find("123") != string::npos);
+    }
+
+    SUBCASE("adjmat::save/load")
+    {
+        edge_set edges{{{10, 2}, 1}, {{2, 30}, -1}, {{30, 10}, 1}};
+        adjmat tmat(edges);
+        tmat.infmap(7);
+
+        std::stringstream buf;
+        tmat.save(buf);
+        adjmat back = adjmat::load(buf);
+        CHECK(back == tmat);
+        CHECK(back.vmap() == tmat.vmap());
+        CHECK(back.infmap() == 7);
+
+        auto fname =
+            (std::filesystem::temp_directory_path() / "lab5-adjmat-test.adjm")
+                .string();
+        tmat.save(fname);
+        {
+            mapped_adjmat mapped(fname);
+            CHECK(mapped.dim() == 3);
+            CHECK(mapped(0, 2) == tmat(0, 2));
+            CHECK(mapped.vmap() == tmat.vmap());
+            CHECK(mapped.to_adjmat() == tmat);
+        }
+        CHECK(adjmat::load(fname) == tmat);
+        std::filesystem::remove(fname);
+
+        std::stringstream junk("1 2\n3 4\n");
+        CHECK_THROWS_AS(adjmat::load(junk), std::runtime_error);
+
+        // a repeated label would leave the vertex map short of the rows
+        {
+            string dup = buf.str();
+            int32_t first;
+            std::memcpy(&first, dup.data() + sizeof(adjmat_header),
+                        sizeof(first));
+            std::memcpy(dup.data() + sizeof(adjmat_header) + sizeof(first),
+                        &first, sizeof(first));
+            std::stringstream dupbuf(dup);
+            CHECK_THROWS_WITH(adjmat::load(dupbuf),
+                              "<istream>: duplicate vertex label");
+            std::ofstream(fname, std::ios::binary) << dup;
+            CHECK_THROWS_WITH(mapped_adjmat{fname},
+                              (fname + ": duplicate vertex label").c_str());
+            std::filesystem::remove(fname);
+        }
+
+        // a header claiming far more than follows fails as truncated
+        // before the cells are allocated, seekable or not.
+        string saved = buf.str();
+        adjmat_header hdr;
+        std::memcpy(&hdr, saved.data(), sizeof(hdr));
+        hdr.dim = uint64_t(1) << 28;
+        string huge = saved;
+        std::memcpy(huge.data(), &hdr, sizeof(hdr));
+        std::stringstream seekable(huge);
+        CHECK_THROWS_WITH(adjmat::load(seekable),
+                          "<istream>: truncated matrix");
+        struct pipe_buf : std::stringbuf {
+            using std::stringbuf::stringbuf;
+            pos_type seekoff(off_type, std::ios::seekdir,
+                             std::ios::openmode) override
+            {
+                return pos_type(off_type(-1));
+            }
+        };
+        pipe_buf pbuf(huge);
+        std::istream piped(&pbuf);
+        CHECK_THROWS_WITH(adjmat::load(piped), "<istream>: truncated matrix");
+        pipe_buf whole(saved);
+        std::istream piped_whole(&whole);
+        CHECK(adjmat::load(piped_whole) == tmat);
+
+        hdr.dim = uint64_t(1) << 62;
+        std::memcpy(huge.data(), &hdr, sizeof(hdr));
+        std::stringstream wraps(huge);
+        CHECK_THROWS_WITH(adjmat::load(wraps),
+                          "<istream>: saved matrix too large");
+
+        string cut = saved.substr(0, saved.size() - 1);
+        std::stringstream short_cells(cut);
+        CHECK_THROWS_WITH(adjmat::load(short_cells),
+                          "<istream>: truncated matrix");
+    }
+
     SUBCASE("adjmat::operator()")
     {
         adjmat tmat{{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
@@ -294,7 +798,7 @@ TEST_CASE("adjmat")
 
     SUBCASE("adjmat::operator[]")
     {
-        std::map<std::pair<int, int>, int> edges{
+        edge_set edges{
             {{1, 1}, 1}, {{2, 2}, 1}, {{3, 3}, 1}, {{4, 4}, 1}, {{5, 5}, 1}};
         adjmat tmat(edges);
 
@@ -6,22 +6,41 @@
 #include <vector>
 #include <initializer_list>
 #include <iostream>
+#include <string>
+#include <cstdint>
+#include <memory_resource>
+
+#include "arena.hpp"
+#include "mapfile.hpp"
 
 class adjmat {
 public:
     adjmat() : _dim{0} {};
-    adjmat(const std::vector<int>& data, size_t dim) : _dim{dim}, _data{data}
+    adjmat(const std::vector<int>& data, size_t dim)
+        : _dim{dim}, _data(data.begin(), data.end())
     {
         if (_data.size() != _dim * _dim) {
             throw std::logic_error("matrix dimension/data mismatch");
         }
     };
 
-    adjmat(size_t dim, const int& val) : _dim{dim}, _data(dim * dim, val){};
+    // constructors taking `mem` allocate from it, the others from the
+    // default resource (see arena.hpp)
+    explicit adjmat(std::pmr::memory_resource* mem)
+        : _dim{0}, _vmap(mem), _data(mem){};
+    adjmat(size_t dim, const int& val,
+           std::pmr::memory_resource* mem = std::pmr::get_default_resource())
+        : _dim{dim}, _vmap{default_vmap(dim, mem)},
+          _data(dim * dim, val, mem){};
+    // a copy of `other` in `mem`
+    adjmat(const adjmat& other, std::pmr::memory_resource* mem)
+        : _dim{other._dim}, _vmap(other._vmap, mem), _data(other._data, mem),
+          _inf{other._inf} {};
 
     adjmat(std::initializer_list<std::initializer_list<int>> data);
     adjmat(const std::vector<std::vector<int>>& data);
-    adjmat(const std::map<std::pair<int, int>, int>& edges);
+    adjmat(const edge_set& edges,
+           std::pmr::memory_resource* mem = std::pmr::get_default_resource());
 
     // operator() indexes with "true" index pairs corresponding to memory
     int& operator()(const int r, const int c) { return _data.at(r * _dim + c); }
@@ -41,37 +60,140 @@ public:
         return operator()(_vmap.at(idx.first), _vmap.at(idx.second));
     }
 
+    // where the cells are allocated
+    std::pmr::memory_resource* resource() const
+    {
+        return _data.get_allocator().resource();
+    }
+
+    // unchecked pointer to the first cell of row r
+    const int* row(size_t r) const { return _data.data() + r * _dim; }
+
+    // smallest and largest cell values, found in one pass over the cells
+    std::pair<int, int> range() const;
+
     size_t dim() const { return _dim; }
     // assigns a value to map to infinity
     void infmap(const int& i) { _inf = i; }
+    const int& infmap() const { return _inf; }
 
-    void vmap(const std::map<int, size_t>& nvmap) { _vmap = nvmap; }
-    std::map<int, size_t>& vmap() { return _vmap; }
-    const std::map<int, size_t>& vmap() const { return _vmap; }
+    void vmap(const vertex_map& nvmap) { _vmap = nvmap; }
+    vertex_map& vmap() { return _vmap; }
+    const vertex_map& vmap() const { return _vmap; }
+
+    // binary serialization: a header with the dimension, element type and
+    // value mapped to infinity, then the vertex label of each index, then the
+    // raw cells in row-major order. see adjmat_header.
+    void save(std::ostream& os) const;
+    void save(const std::string& fname) const;
+    static adjmat load(std::istream& is);
+    static adjmat load(const std::string& fname);
 
     friend std::istream& operator>>(std::istream&, adjmat&);
     friend std::ostream& operator<<(std::ostream&, const adjmat&);
+    // fills its copy's cells straight from the mapping
+    friend class mapped_adjmat;
 
     friend bool operator==(const adjmat& lhs, const adjmat& rhs)
     {
         return lhs._dim == rhs._dim && lhs._data == rhs._data;
     }
 
-private:
-    // returns vertices from an edge set.
-    static std::set<int>
-    get_vertices(const std::map<std::pair<int, int>, int>& edges);
+    // maps each vertex of an edge set to its index, in label order.
+    static vertex_map gen_vmap(
+        const edge_set& edges,
+        std::pmr::memory_resource* mem = std::pmr::get_default_resource());
 
-    static std::map<int, size_t> default_vmap(size_t dim);
-    static std::map<int, size_t>
-    gen_vmap(const std::map<std::pair<int, int>, int>& edges);
+private:
+    static vertex_map default_vmap(
+        size_t dim,
+        std::pmr::memory_resource* mem = std::pmr::get_default_resource());
 
     size_t _dim;
     // maps vertex label to index
-    std::map<int, size_t> _vmap = default_vmap(_dim);
-    std::vector<int> _data;
+    vertex_map _vmap = default_vmap(_dim);
+    // cells row by row. pmr so that a run can keep them in its arena and
+    // large matrices can be put on huge pages (see hugepage.hpp)
+    std::pmr::vector<int> _data;
     // maps a specific value to infinity for printing
     int _inf = 2;
 };
 
+// leading block of a saved adjmat. fields are in host byte order; `bom` lets
+// a reader reject files from a machine of the other endianness.
+struct adjmat_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t bom;
+    uint32_t elem; // size in bytes of one (signed) cell
+    uint64_t dim;
+    int32_t inf;
+    uint32_t reserved;
+};
+
+inline constexpr char adjmat_magic[4] = {'A', 'D', 'J', 'M'};
+
+// a saved adjmat used in place from a read-only mapping of the file, without
+// copying its cells.
+class mapped_adjmat {
+public:
+    explicit mapped_adjmat(const std::string& fname);
+
+    size_t dim() const { return _dim; }
+    int infmap() const { return _inf; }
+    const int* row(size_t r) const { return _cells + r * _dim; }
+    int operator()(size_t r, size_t c) const { return row(r)[c]; }
+    // vertex label of each index
+    const int32_t* labels() const { return _labels; }
+
+    vertex_map vmap() const;
+    // copies the cells into an owning adjmat
+    adjmat to_adjmat() const;
+
+private:
+    mapped_file _file;
+    size_t _dim;
+    int _inf;
+    const int32_t* _labels;
+    const int* _cells;
+};
+
+// a rectangular block of an adjmat selected by vertex label, in the order
+// given. labels the matrix doesn't have read as infinity.
+class adjview {
+public:
+    // the whole matrix
+    adjview(const adjmat& mat);
+    adjview(const adjmat& mat, std::vector<int> rows, std::vector<int> cols);
+
+    size_t rows() const { return _rlabels.size(); }
+    size_t cols() const { return _clabels.size(); }
+    const std::vector<int>& row_labels() const { return _rlabels; }
+    const std::vector<int>& col_labels() const { return _clabels; }
+    const int& infmap() const { return _mat->infmap(); }
+
+    int operator()(size_t r, size_t c) const
+    {
+        const int* src = _rowp[r];
+        return src && _cidx[c] >= 0 ? src[_cidx[c]] : _mat->infmap();
+    }
+
+    // smallest and largest values in the view, in one pass over its cells
+    std::pair<int, int> range() const;
+
+private:
+    const adjmat* _mat;
+    std::vector<int> _rlabels;
+    std::vector<int> _clabels;
+    // first cell of each selected row, null if the label is missing
+    std::vector<const int*> _rowp;
+    // matrix column of each selected column, -1 if the label is missing
+    std::vector<ptrdiff_t> _cidx;
+    bool _whole = false;
+};
+
+// draws the table operator<< does for any view, formatting rows on nthreads
+// threads.
+void write_table(std::ostream& os, const adjview& view, unsigned nthreads);
+
 #endif
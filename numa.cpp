@@ -0,0 +1,142 @@
+#include "numa.hpp"
+
+#include <charconv>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace fs = std::filesystem;
+
+std::vector<int> parse_cpulist(std::string_view list)
+{
+    std::vector<int> cpus;
+    while (!list.empty()) {
+        auto comma = list.find(',');
+        auto item = list.substr(0, comma);
+        list = comma == list.npos ? "" : list.substr(comma + 1);
+
+        int lo = 0, hi = 0;
+        const char* end = item.data() + item.size();
+        auto [p, ec] = std::from_chars(item.data(), end, lo);
+        if (ec != std::errc()) {
+            continue;
+        }
+        hi = lo;
+        if (p != end && *p == '-') {
+            std::from_chars(p + 1, end, hi);
+        }
+        for (int cpu = lo; cpu <= hi; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<std::vector<int>> numa_nodes(const std::string& root)
+{
+    std::vector<std::pair<int, std::vector<int>>> nodes;
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(root, ec)) {
+        std::string name = entry.path().filename();
+        int id;
+        if (!name.starts_with("node") ||
+            std::from_chars(name.data() + 4, name.data() + name.size(), id)
+                    .ec != std::errc()) {
+            continue;
+        }
+        std::ifstream in(entry.path() / "cpulist");
+        std::string list;
+        std::getline(in, list);
+        if (auto cpus = parse_cpulist(list); !cpus.empty()) {
+            nodes.emplace_back(id, std::move(cpus));
+        }
+    }
+    std::ranges::sort(nodes);
+
+    std::vector<std::vector<int>> cpus;
+    for (auto& node : nodes) {
+        cpus.push_back(std::move(node.second));
+    }
+    if (cpus.empty()) {
+        // one node, holding whatever we may run on
+        cpus.push_back(thread_cpus());
+    }
+    return cpus;
+}
+
+// affinity is linux only; elsewhere threads are never pinned.
+#ifdef __linux__
+std::vector<int> thread_cpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+bool pin_thread(const std::vector<int>& cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return CPU_COUNT(&set) && sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+#else
+std::vector<int> thread_cpus()
+{
+    return {};
+}
+
+bool pin_thread(const std::vector<int>&)
+{
+    return false;
+}
+#endif
+
+#ifdef TESTING
+#include "doctest.h"
+
+TEST_CASE("numa")
+{
+    CHECK(parse_cpulist("0-3,8,10-11\n") ==
+          std::vector<int>{0, 1, 2, 3, 8, 10, 11});
+    CHECK(parse_cpulist("") == std::vector<int>{});
+
+    SUBCASE("numa_nodes")
+    {
+        auto root = fs::temp_directory_path() / "lab5-numa-test";
+        fs::remove_all(root);
+        for (auto [node, list] : {std::pair{"node1", "2-3"},
+                                  std::pair{"node0", "0-1"},
+                                  std::pair{"node2", ""}}) {
+            fs::create_directories(root / node);
+            std::ofstream(root / node / "cpulist") << list << '\n';
+        }
+        fs::create_directories(root / "power");
+
+        // node2 has no CPUs and is left out
+        auto nodes = numa_nodes(root);
+        CHECK(nodes == std::vector<std::vector<int>>{{0, 1}, {2, 3}});
+        fs::remove_all(root);
+
+        // no sysfs at all is a single node
+        CHECK(numa_nodes(root).size() == 1);
+    }
+
+    CHECK_FALSE(pin_thread({}));
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <string>
+#include <vector>
+#include <string_view>
+
+// just enough NUMA awareness to place a parallel engine's memory, read from
+// sysfs so there's nothing to link. linux places a page on the node of the
+// thread that first writes it, so a worker pinned to a node that is first to
+// touch its own rows gets them local.
+
+// the CPUs of a cpulist such as "0-3,8,10-11"
+std::vector<int> parse_cpulist(std::string_view list);
+
+// the CPUs of each online node, from `root` (normally
+// /sys/devices/system/node). a machine without the directory, or whose
+// nodes can't be read, is treated as one node holding every CPU, as is one
+// with no CPUs listed at all.
+std::vector<std::vector<int>>
+numa_nodes(const std::string& root = "/sys/devices/system/node");
+
+// the CPUs the calling thread may run on
+std::vector<int> thread_cpus();
+
+// restricts the calling thread to `cpus`. returns false, leaving it as it
+// was, if that isn't possible.
+bool pin_thread(const std::vector<int>& cpus);
+
+#endif
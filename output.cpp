@@ -0,0 +1,206 @@
+#include "output.hpp"
+#include "render.hpp"
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+using std::string, std::string_view;
+
+namespace {
+
+void write_sparse(std::ostream& os, const adjview& view, unsigned nthreads)
+{
+    const auto& rlbl = view.row_labels();
+    const auto& clbl = view.col_labels();
+    render_rows(os, view.rows(), [&](string& buf, size_t r0, size_t r1) {
+        for (auto r = r0; r < r1; ++r) {
+            for (auto c = 0u; c < view.cols(); ++c) {
+                if (view(r, c) == 0) {
+                    append_int(buf, rlbl[r], 0);
+                    buf += ' ';
+                    append_int(buf, clbl[c], 0);
+                    buf += '\n';
+                }
+            }
+        }
+    }, nthreads);
+}
+
+void append_labels(string& buf, const std::vector<int>& labels)
+{
+    for (int l : labels) {
+        buf += ' ';
+        append_int(buf, l, 0);
+    }
+    buf += '\n';
+}
+
+// rows are packed most significant bit first and padded to whole bytes, as
+// P4 requires. labels go in header comments since the bitmap can't carry
+// them; a square view over the same labels lists them once.
+void write_dense(std::ostream& os, const adjview& view, unsigned nthreads)
+{
+    size_t ncols = view.cols();
+    string head = "P4\n";
+    if (view.row_labels() == view.col_labels()) {
+        head += "# labels";
+        append_labels(head, view.row_labels());
+    }
+    else {
+        head += "# rows";
+        append_labels(head, view.row_labels());
+        head += "# cols";
+        append_labels(head, view.col_labels());
+    }
+    head += std::to_string(ncols) + ' ' + std::to_string(view.rows()) + '\n';
+    os.write(head.data(), head.size());
+
+    size_t rowbytes = (ncols + 7) / 8;
+    render_rows(os, view.rows(), [&](string& buf, size_t r0, size_t r1) {
+        for (auto r = r0; r < r1; ++r) {
+            size_t start = buf.size();
+            buf.append(rowbytes, '\0');
+            for (auto c = 0u; c < ncols; ++c) {
+                if (view(r, c) == 0) {
+                    buf[start + c / 8] |= char(0x80u >> (c % 8));
+                }
+            }
+        }
+    }, nthreads);
+}
+
+void write_csv(std::ostream& os, const adjview& view, unsigned nthreads)
+{
+    const auto& rlbl = view.row_labels();
+    int inf = view.infmap();
+
+    string head;
+    for (int l : view.col_labels()) {
+        head += ',';
+        append_int(head, l, 0);
+    }
+    head += '\n';
+    os.write(head.data(), head.size());
+
+    render_rows(os, view.rows(), [&](string& buf, size_t r0, size_t r1) {
+        for (auto r = r0; r < r1; ++r) {
+            append_int(buf, rlbl[r], 0);
+            for (auto c = 0u; c < view.cols(); ++c) {
+                int val = view(r, c);
+                buf += ',';
+                if (val == inf) {
+                    buf += "inf";
+                }
+                else {
+                    append_int(buf, val, 0);
+                }
+            }
+            buf += '\n';
+        }
+    }, nthreads);
+}
+
+} // namespace
+
+out_format parse_format(string_view name)
+{
+    if (name == "box") {
+        return out_format::box;
+    }
+    else if (name == "sparse") {
+        return out_format::sparse;
+    }
+    else if (name == "dense") {
+        return out_format::dense;
+    }
+    else if (name == "csv") {
+        return out_format::csv;
+    }
+    throw std::runtime_error("unknown format '" + string(name) + "'");
+}
+
+void write_result(std::ostream& os, const adjview& view, out_format fmt,
+                  unsigned nthreads)
+{
+    switch (fmt) {
+    case out_format::box:
+        write_table(os, view, nthreads);
+        break;
+    case out_format::sparse:
+        write_sparse(os, view, nthreads);
+        break;
+    case out_format::dense:
+        write_dense(os, view, nthreads);
+        break;
+    case out_format::csv:
+        write_csv(os, view, nthreads);
+        break;
+    }
+}
+
+#ifdef TESTING
+#include "doctest.h"
+
+#include <sstream>
+
+TEST_CASE("write_result")
+{
+    edge_set edges{{{3, 5}, 1}, {{5, 9}, -1}};
+    adjmat mat(edges);
+    mat[{3, 9}] = 0;
+    mat[{9, 9}] = 0;
+
+    std::ostringstream out;
+
+    SUBCASE("sparse")
+    {
+        write_result(out, mat, out_format::sparse);
+        CHECK(out.str() == "3 9\n9 9\n");
+    }
+
+    SUBCASE("dense")
+    {
+        write_result(out, mat, out_format::dense);
+        CHECK(out.str() == string("P4\n# labels 3 5 9\n3 3\n"
+                                  "\x20\x00\x20",
+                                  25));
+    }
+
+    SUBCASE("csv")
+    {
+        write_result(out, mat, out_format::csv);
+        CHECK(out.str() == ",3,5,9\n3,inf,1,0\n5,inf,inf,-1\n9,inf,inf,0\n");
+    }
+
+    SUBCASE("threaded")
+    {
+        std::ostringstream serial;
+        for (auto fmt : {out_format::box, out_format::sparse, out_format::dense,
+                         out_format::csv}) {
+            serial.str("");
+            out.str("");
+            write_result(serial, mat, fmt);
+            write_result(out, mat, fmt, 3);
+            CHECK(out.str() == serial.str());
+        }
+    }
+
+    SUBCASE("window")
+    {
+        adjview view(mat, {3, 9}, {9});
+        write_result(out, view, out_format::sparse);
+        CHECK(out.str() == "3 9\n9 9\n");
+
+        out.str("");
+        write_result(out, view, out_format::dense);
+        CHECK(out.str() == string("P4\n# rows 3 9\n# cols 9\n1 2\n"
+                                  "\x80\x80",
+                                  29));
+    }
+
+    CHECK(parse_format("csv") == out_format::csv);
+    CHECK_THROWS_AS(parse_format("xml"), std::runtime_error);
+}
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef OUTPUT_HPP
+#define OUTPUT_HPP
+
+#include "matrix.hpp"
+
+#include <iostream>
+#include <string_view>
+
+// result output formats.
+//
+//  box     the Unicode table operator<< draws
+//  sparse  one `u v` line of vertex labels per zero-cost path
+//  dense   binary PBM (P4) bitmap, a set bit for each zero-cost path
+//  csv     label header row, then one row per vertex; ∞ is written `inf`
+enum class out_format { box, sparse, dense, csv };
+
+out_format parse_format(std::string_view name);
+
+// rows are formatted on `nthreads` threads and written in order. a whole
+// adjmat converts to a view of itself.
+void write_result(std::ostream& os, const adjview& view, out_format fmt,
+                  unsigned nthreads = 1);
+
+#endif
@@ -1,12 +1,31 @@
 #include <array>
+#include <vector>
+#include <algorithm>
+#include <iomanip>
+#include <ranges>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <optional>
+#include <filesystem>
 #include "paths.hpp"
+#include "bitpaths.hpp"
+#include "datalog.hpp"
+#include "cfl.hpp"
 
-// initialize D[-1], D[0], D[1] from a single adjacency matrix
-static std::array<adjmat, 3> init_adjmats(const adjmat& mat)
+namespace fs = std::filesystem;
+
+// initialize D[-1], D[0], D[1] from a single adjacency matrix, in `mem`
+static std::array<adjmat, 3> init_adjmats(const adjmat& mat,
+                                          std::pmr::memory_resource* mem)
 {
-    auto blank = adjmat(mat.dim(), 2);
-    blank.vmap(mat.vmap());
-    std::array<adjmat, 3> mats{blank, blank, blank};
+    std::array<adjmat, 3> mats{adjmat(mat.dim(), 2, mem),
+                               adjmat(mat.dim(), 2, mem),
+                               adjmat(mat.dim(), 2, mem)};
+    for (auto& m : mats) {
+        m.vmap(mat.vmap());
+    }
     for (auto r = 0u; r < mat.dim(); ++r) {
         for (auto c = 0u; c < mat.dim(); ++c) {
             int val = mat(r, c);
@@ -26,48 +45,390 @@ static std::array<adjmat, 3> init_adjmats(const adjmat& mat)
     return mats;
 }
 
+path_engine parse_engine(std::string_view name)
+{
+    if (name == "reference") {
+        return path_engine::reference;
+    }
+    else if (name == "fourrussians") {
+        return path_engine::fourrussians;
+    }
+    else if (name == "doubling") {
+        return path_engine::doubling;
+    }
+    else if (name == "worklist") {
+        return path_engine::worklist;
+    }
+    else if (name == "datalog") {
+        return path_engine::datalog;
+    }
+    else if (name == "cfl") {
+        return path_engine::cfl;
+    }
+    else if (name == "parallel") {
+        return path_engine::parallel;
+    }
+    throw std::runtime_error("unknown engine '" + std::string(name) + "'");
+}
+
+// runs one of the boolean engines on D[-1], D[0], D[1] and writes the facts
+// it found back into them.
+static adjmat boolean_engine(adjmat& dm1, adjmat& d0, adjmat& d1,
+                             const path_options& opts)
+{
+    bitmat neg(dm1, -1), zero(d0, 0), pos(d1, 1);
+    switch (opts.engine) {
+    case path_engine::fourrussians:
+        closure_fourrussians(neg, zero, pos, opts);
+        break;
+    case path_engine::doubling:
+        closure_doubling(neg, zero, pos, opts);
+        break;
+    case path_engine::worklist:
+        closure_worklist(neg, zero, pos, opts);
+        break;
+    case path_engine::parallel:
+        closure_parallel(neg, zero, pos, opts);
+        break;
+    case path_engine::reference:
+    case path_engine::datalog:
+    case path_engine::cfl:
+        [[unlikely]] throw std::runtime_error("unreachable");
+    }
+    neg.store(dm1, -1);
+    zero.store(d0, 0);
+    pos.store(d1, 1);
+    return adjmat(d0, opts.resource());
+}
+
+// runs the algorithm's rules as Datalog over sparse relations
+//
+//      neg(i, j)  :- neg(i, k), zero(k, j).
+//      neg(i, j)  :- zero(i, k), neg(k, j).
+//      zero(i, j) :- neg(i, k), pos(k, j).
+//      zero(i, j) :- pos(i, k), neg(k, j).
+//      pos(i, j)  :- pos(i, k), zero(k, j).
+//      pos(i, j)  :- zero(i, k), pos(k, j).
+//
+// and writes the facts found back into D[-1], D[0], D[1].
+static adjmat datalog_engine(adjmat& dm1, adjmat& d0, adjmat& d1,
+                             const path_options& opts)
+{
+    using clock = std::chrono::steady_clock;
+    enum { neg, zero, pos };
+    adjmat* mats[3] = {&dm1, &d0, &d1};
+    size_t n = d0.dim();
+
+    std::vector<datalog::relation> rels(3, datalog::relation(n));
+    for (int m = 0; m < 3; ++m) {
+        for (auto r = 0u; r < n; ++r) {
+            const int* cells = mats[m]->row(r);
+            for (auto c = 0u; c < n; ++c) {
+                if (cells[c] == m - 1) {
+                    rels[m].insert(r, c);
+                }
+            }
+        }
+    }
+
+    auto begin = clock::now();
+    auto swept = begin;
+    std::function<void(const datalog::round_stats&)> on_round;
+    if (opts.on_sweep) {
+        on_round = [&](const datalog::round_stats& round) {
+            auto now = clock::now();
+            std::chrono::duration<double> took = now - swept;
+            sweep_stats stats{round.round, 3 * int64_t(n * n) - 1};
+            std::copy_n(round.found.begin(), 3, stats.changed);
+            stats.elapsed = now - begin;
+            stats.updates_per_sec =
+                double(round.joins) / std::max(took.count(), 1e-9);
+            opts.on_sweep(stats);
+            swept = clock::now();
+        };
+    }
+    datalog::evaluate(rels,
+                      {{neg, neg, zero},
+                       {neg, zero, neg},
+                       {zero, neg, pos},
+                       {zero, pos, neg},
+                       {pos, pos, zero},
+                       {pos, zero, pos}},
+                      on_round);
+
+    for (int m = 0; m < 3; ++m) {
+        for (auto a = 0u; a < n; ++a) {
+            for (int b : rels[m].succ(a)) {
+                (*mats[m])(a, b) = m - 1;
+            }
+        }
+    }
+    return adjmat(d0, opts.resource());
+}
+
+void report_sweep(std::ostream& os, const sweep_stats& stats)
+{
+    // formatted apart so the caller's stream keeps its own precision
+    std::ostringstream line;
+    line << "sweep " << stats.sweep << "/" << stats.sweeps << ": changed "
+         << stats.changed[0] << "/" << stats.changed[1] << "/"
+         << stats.changed[2] << " (D[-1]/D[0]/D[1]), " << std::fixed
+         << std::setprecision(2) << stats.elapsed.count() << "s elapsed, "
+         << std::scientific << std::setprecision(3) << stats.updates_per_sec
+         << " cell-updates/s";
+    if (!stats.utilization.empty()) {
+        line << ", utilization";
+        char sep = ' ';
+        for (double u : stats.utilization) {
+            line << sep << int(u * 100 + 0.5) << '%';
+            sep = '/';
+        }
+    }
+    line << '\n';
+    os << line.str();
+}
+
+// checkpoint file: this header, then D[-1], D[0] and D[1] as saved by
+// adjmat::save.
+struct checkpoint_header {
+    char magic[4];
+    uint32_t version;
+    uint64_t fingerprint; // of the input matrices
+    int64_t sweep;        // last completed sweep
+};
+
+static constexpr char checkpoint_magic[4] = {'C', 'K', 'P', 'T'};
+static constexpr uint32_t checkpoint_version = 1;
+
+// FNV-1a over the cells of the input matrices, so a checkpoint is only ever
+// resumed against the run it was taken from.
+static uint64_t fingerprint(const adjmat& dm1, const adjmat& d0,
+                            const adjmat& d1)
+{
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (const adjmat* m : {&dm1, &d0, &d1}) {
+        for (auto r = 0u; r < m->dim(); ++r) {
+            const int* row = m->row(r);
+            for (auto c = 0u; c < m->dim(); ++c) {
+                h ^= static_cast<uint32_t>(row[c]);
+                h *= 0x100000001b3ull;
+            }
+        }
+    }
+    return h;
+}
+
+// written beside the checkpoint and renamed over it, so a run killed while
+// saving still leaves the previous checkpoint intact.
+static void save_checkpoint(const std::string& fname, uint64_t print,
+                            int64_t sweep, const adjmat& dm1, const adjmat& d0,
+                            const adjmat& d1)
+{
+    checkpoint_header hdr{};
+    std::memcpy(hdr.magic, checkpoint_magic, sizeof(hdr.magic));
+    hdr.version = checkpoint_version;
+    hdr.fingerprint = print;
+    hdr.sweep = sweep;
+
+    std::string tmp = fname + ".tmp";
+    {
+        std::ofstream ofile(tmp, std::ios::binary | std::ios::trunc);
+        if (!ofile.is_open()) {
+            throw std::runtime_error(tmp + ": cannot open for writing");
+        }
+        ofile.write(reinterpret_cast<const char*>(&hdr), sizeof(hdr));
+        dm1.save(ofile);
+        d0.save(ofile);
+        d1.save(ofile);
+    }
+    fs::rename(tmp, fname);
+}
+
+// restores D[-1], D[0], D[1] and returns the last completed sweep, or nothing
+// if there is no checkpoint yet.
+static std::optional<int64_t> load_checkpoint(const std::string& fname,
+                                              uint64_t print, adjmat& dm1,
+                                              adjmat& d0, adjmat& d1)
+{
+    std::ifstream ifile(fname, std::ios::binary);
+    if (!ifile.is_open()) {
+        return std::nullopt;
+    }
+    checkpoint_header hdr;
+    if (!ifile.read(reinterpret_cast<char*>(&hdr), sizeof(hdr)) ||
+        std::memcmp(hdr.magic, checkpoint_magic, sizeof(hdr.magic)) != 0 ||
+        hdr.version != checkpoint_version) {
+        throw std::runtime_error(fname + ": not a checkpoint");
+    }
+    if (hdr.fingerprint != print) {
+        throw std::runtime_error(fname + ": checkpoint is for different input");
+    }
+
+    adjmat mats[3];
+    for (auto& m : mats) {
+        m = adjmat::load(ifile);
+        if (m.dim() != d0.dim()) {
+            throw std::runtime_error(fname + ": checkpoint dimension mismatch");
+        }
+    }
+    dm1 = std::move(mats[0]);
+    d0 = std::move(mats[1]);
+    d1 = std::move(mats[2]);
+    return hdr.sweep;
+}
+
 // runs the assignment algorithm from an edge set.
-adjmat exact0paths(const std::map<std::pair<int, int>, int>& edges)
+adjmat exact0paths(const edge_set& edges, const path_options& opts)
+{
+    if (opts.engine == path_engine::cfl) {
+        if (!opts.checkpoint.empty()) {
+            throw std::runtime_error(
+                "checkpointing is only supported by the reference engine");
+        }
+        // straight from the edges, skipping the three input matrices
+        return cfl0paths(edges, opts).to_adjmat(opts.resource());
+    }
+    return exact0paths(adjmat(edges, opts.resource()), opts);
+}
+
+// a zero-cost path from s only ever passes through vertices reachable from s,
+// and so does every sub-path the algorithm combines to find it. the induced
+// subgraph on those vertices therefore gives exact rows for the sources.
+adjmat exact0paths_from(const edge_set& edges, const std::set<int>& sources,
+                        const path_options& opts)
 {
-    return exact0paths(adjmat(edges));
+    auto* mem = opts.resource();
+    std::pmr::map<int, std::pmr::vector<int>> succ(mem);
+    for (const auto& [v1, v2] : edges | std::views::keys) {
+        succ[v1].push_back(v2);
+    }
+
+    std::pmr::set<int> reached(sources.begin(), sources.end(), mem);
+    std::pmr::vector<int> frontier(sources.begin(), sources.end(), mem);
+    while (!frontier.empty()) {
+        int v = frontier.back();
+        frontier.pop_back();
+        if (auto it = succ.find(v); it != succ.end()) {
+            for (int w : it->second) {
+                if (reached.insert(w).second) {
+                    frontier.push_back(w);
+                }
+            }
+        }
+    }
+
+    edge_set sub(mem);
+    for (const auto& [verts, wt] : edges) {
+        if (reached.contains(verts.first)) {
+            sub.insert(sub.cend(), {verts, wt});
+        }
+    }
+    if (sub.empty()) {
+        return adjmat(mem);
+    }
+    return exact0paths(sub, opts);
 }
 
 // runs the assignment algorithm from a single adjacency matrix
-adjmat exact0paths(const adjmat& mat)
+adjmat exact0paths(const adjmat& mat, const path_options& opts)
 {
-    auto mats = init_adjmats(mat);
-    return exact0paths(mats[0], mats[1], mats[2]);
+    auto mats = init_adjmats(mat, opts.resource());
+    return exact0paths(mats[0], mats[1], mats[2], opts);
 }
 
 // runs the assignment algorithm.
-adjmat exact0paths(adjmat& dm1, adjmat& d0, adjmat& d1)
+adjmat exact0paths(adjmat& dm1, adjmat& d0, adjmat& d1,
+                   const path_options& opts)
 {
+    using clock = std::chrono::steady_clock;
+
+    if (opts.engine != path_engine::reference) {
+        if (!opts.checkpoint.empty()) {
+            throw std::runtime_error(
+                "checkpointing is only supported by the reference engine");
+        }
+        if (opts.engine == path_engine::datalog) {
+            return datalog_engine(dm1, d0, d1, opts);
+        }
+        if (opts.engine == path_engine::cfl) {
+            return cfl0paths(dm1, d0, d1, opts);
+        }
+        return boolean_engine(dm1, d0, d1, opts);
+    }
+
     int n = d0.dim();
-    for (int l = 2; l < 3 * n * n + 1; ++l) {
+    int start = 2;
+    uint64_t print = 0;
+    bool checkpointing = !opts.checkpoint.empty();
+    if (checkpointing) {
+        print = fingerprint(dm1, d0, d1);
+        if (opts.resume) {
+            if (auto done = load_checkpoint(opts.checkpoint, print, dm1, d0,
+                                            d1)) {
+                start = *done + 1;
+            }
+        }
+    }
+    auto begin = clock::now();
+    auto saved = begin;
+    int64_t sweeps = 3 * int64_t(n) * n - 1;
+
+    for (int l = start; l < 3 * n * n + 1; ++l) {
+        auto swept = clock::now();
+        size_t changed[3] = {0, 0, 0};
         for (int i = 0; i < n; ++i) {
             for (int j = 0; j < n; ++j) {
                 for (int k = 0; k < n; ++k) {
-                    if (dm1(i, k) + d1(k, j) == 0 ||
-                        d1(i, k) + dm1(k, j) == 0) {
+                    if ((dm1(i, k) + d1(k, j) == 0 ||
+                         d1(i, k) + dm1(k, j) == 0) &&
+                        d0(i, j) != 0) {
                         d0(i, j) = 0;
+                        ++changed[1];
                     }
-                    if (d1(i, k) + d0(k, j) == 1 || d0(i, k) + d1(k, j) == 1) {
+                    if ((d1(i, k) + d0(k, j) == 1 ||
+                         d0(i, k) + d1(k, j) == 1) &&
+                        d1(i, j) != 1) {
                         d1(i, j) = 1;
+                        ++changed[2];
                     }
-                    if (dm1(i, k) + d0(k, j) == -1 ||
-                        d0(i, k) + dm1(k, j) == -1) {
+                    if ((dm1(i, k) + d0(k, j) == -1 ||
+                         d0(i, k) + dm1(k, j) == -1) &&
+                        dm1(i, j) != -1) {
                         dm1(i, j) = -1;
+                        ++changed[0];
                     }
                 }
             }
         }
+
+        if (opts.on_sweep) {
+            auto now = clock::now();
+            std::chrono::duration<double> took = now - swept;
+            sweep_stats stats{l - 1, sweeps};
+            std::copy(changed, changed + 3, stats.changed);
+            stats.elapsed = now - begin;
+            stats.updates_per_sec =
+                double(n) * n * n / std::max(took.count(), 1e-9);
+            opts.on_sweep(stats);
+        }
+
+        if (checkpointing && clock::now() - saved >= opts.checkpoint_every) {
+            save_checkpoint(opts.checkpoint, print, l, dm1, d0, d1);
+            saved = clock::now();
+        }
     }
 
-    return d0;
+    if (checkpointing) {
+        fs::remove(opts.checkpoint);
+    }
+    return adjmat(d0, opts.resource());
 }
 
 #ifdef TESTING
 #include "doctest.h"
+#include "csg.hpp"
+
+#include <sstream>
 
 TEST_CASE("exact0paths")
 {
@@ -82,6 +443,67 @@ TEST_CASE("exact0paths")
         CHECK(exact0paths(tm1, t0, t1) == zero);
     }
 
+    SUBCASE("checkpoint and resume")
+    {
+        adjmat tm1{{-1, 2, 2, 2}, {2, 2, 2, 2}, {2, 2, 2, 2}, {2, 2, 2, 2}};
+        adjmat t0(4, 2);
+        adjmat t1{{2, 1, 2, 2}, {2, 2, 1, 2}, {2, 2, 2, 1}, {1, 2, 2, 2}};
+        auto fname =
+            (fs::temp_directory_path() / "lab5-checkpoint-test.ckpt").string();
+
+        path_options opts;
+        opts.checkpoint = fname;
+        opts.checkpoint_every = std::chrono::seconds(0);
+        opts.resume = true;
+
+        // a run preempted after its first sweep
+        adjmat m1 = tm1, m0 = t0, p1 = t1;
+        save_checkpoint(fname, fingerprint(tm1, t0, t1), 2, m1, m0, p1);
+
+        CHECK(exact0paths(m1, m0, p1, opts) == zero);
+        CHECK_FALSE(fs::exists(fname));
+
+        // resuming with no checkpoint starts from scratch
+        m1 = tm1, m0 = t0, p1 = t1;
+        CHECK(exact0paths(m1, m0, p1, opts) == zero);
+
+        // a checkpoint for other input is refused
+        save_checkpoint(fname, 0, 2, m1, m0, p1);
+        m1 = tm1, m0 = t0, p1 = t1;
+        CHECK_THROWS_AS(exact0paths(m1, m0, p1, opts), std::runtime_error);
+        fs::remove(fname);
+    }
+
+    SUBCASE("on_sweep")
+    {
+        adjmat m{{-1, 1, 2, 2}, {2, 2, 1, 2}, {2, 2, 2, 1}, {1, 2, 2, 2}};
+        std::vector<sweep_stats> seen;
+        path_options opts;
+        opts.on_sweep = [&](const sweep_stats& s) { seen.push_back(s); };
+
+        CHECK(exact0paths(m, opts) == zero);
+        REQUIRE(seen.size() == 3 * 4 * 4 - 1);
+        CHECK(seen.front().sweep == 1);
+        CHECK(seen.back().sweep == seen.back().sweeps);
+
+        // every zero cell was set exactly once, and the run converged.
+        size_t zeros = 0;
+        for (const auto& s : seen) {
+            zeros += s.changed[1];
+        }
+        CHECK(zeros == 16);
+        CHECK(seen.back().changed[0] + seen.back().changed[1] +
+                  seen.back().changed[2] ==
+              0);
+
+        // the report leaves the stream's float formatting as it found it
+        std::ostringstream os;
+        report_sweep(os, seen.front());
+        CHECK(os.str().rfind("sweep 1/47: changed ", 0) == 0);
+        os << 3.14159265;
+        CHECK(os.str().ends_with("\n3.14159"));
+    }
+
     SUBCASE("exact0paths(adjmat)")
     {
         adjmat m{{-1, 1, 2, 2}, {2, 2, 1, 2}, {2, 2, 2, 1}, {1, 2, 2, 2}};
@@ -90,11 +512,60 @@ TEST_CASE("exact0paths")
 
     SUBCASE("exact0paths(edges)")
     {
-        std::map<std::pair<int, int>, int> edges{
+        edge_set edges{
             {{1, 1}, -1}, {{1, 2}, 1}, {{2, 3}, 1}, {{3, 4}, 1}, {{4, 1}, 1}};
 
         CHECK(exact0paths(edges) == zero);
     }
+
+    SUBCASE("exact0paths_from(edges, sources)")
+    {
+        // 1 reaches the zero cycle 1..4; 5 and 6 only reach each other.
+        edge_set edges{
+            {{1, 1}, -1}, {{1, 2}, 1}, {{2, 3}, 1}, {{3, 4}, 1},
+            {{4, 1}, 1},  {{5, 6}, 1}, {{6, 5}, -1}, {{5, 1}, -1}};
+        auto full = exact0paths(edges);
+        auto part = exact0paths_from(edges, {5});
+
+        CHECK(part.dim() == 6);
+        for (int v : {1, 2, 3, 4, 5, 6}) {
+            CHECK(part[{5, v}] == full[{5, v}]);
+        }
+
+        auto sink = exact0paths_from(edges, {1});
+        CHECK(sink.dim() == 4);
+        CHECK_FALSE(sink.vmap().contains(5));
+    }
+
+    SUBCASE("run_arena")
+    {
+        auto* heap = std::pmr::get_default_resource();
+        adjmat kept;
+        for (auto engine : {path_engine::reference, path_engine::worklist,
+                            path_engine::datalog, path_engine::cfl}) {
+            run_arena arena;
+            std::istringstream in("1-1\n1+2+3+4+1\n");
+            edge_set edges = csg::parse(in, &arena);
+            CHECK(edges.get_allocator().resource() == &arena);
+
+            path_options opts;
+            opts.engine = engine;
+            opts.memory = &arena;
+            auto result = exact0paths(edges, opts);
+            CHECK(result == zero);
+            CHECK(result.resource() == &arena);
+            CHECK(result.vmap().get_allocator().resource() == &arena);
+
+            auto part = exact0paths_from(edges, {1}, opts);
+            CHECK(part.resource() == &arena);
+            // made outside the arena, so this copies out of it
+            kept = result;
+        }
+        // the arena is never installed as the default
+        CHECK(std::pmr::get_default_resource() == heap);
+        CHECK(kept.resource() == heap);
+        CHECK(kept == zero);
+    }
 }
 
 #endif
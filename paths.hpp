@@ -2,14 +2,102 @@
 #define PATHS_HPP
 
 #include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <functional>
+#include <string_view>
+#include <memory_resource>
 #include "matrix.hpp"
 
-adjmat exact0paths(adjmat& dm1, adjmat& d0, adjmat& d1);
+// what one sweep of the algorithm did.
+struct sweep_stats {
+    int64_t sweep;  // sweeps completed so far, counting this one
+    // sweeps the schedule runs in total; for engines that stop at a fixpoint,
+    // the most they could need
+    int64_t sweeps;
+    // cells newly set in D[-1], D[0] and D[1] during this sweep
+    size_t changed[3];
+    // since the run (or resumed run) started
+    std::chrono::duration<double> elapsed;
+    // (i, j, k) cell updates per second over this sweep
+    double updates_per_sec;
+    // for parallel engines, the share of the sweep each worker was busy
+    std::vector<double> utilization;
+};
+
+// writes one line describing a sweep
+void report_sweep(std::ostream& os, const sweep_stats& stats);
+
+// ways of computing the same result.
+//
+//  reference       the assignment algorithm, 3n² - 1 sweeps over (i, j, k)
+//  fourrussians    sweeps of bit-packed Four Russians boolean matrix products,
+//                  stopping at the fixpoint
+//  doubling        the same products plus zero·zero, doubling the length of
+//                  the zero-weight chains found each round
+//  worklist        semi-naive rounds joining only newly found cells
+//  datalog         the same rounds over sparse indexed tuple sets
+//  cfl             CFL-reachability worklist over the edges, see cfl.hpp
+//  parallel        the worklist's rounds in row blocks on a work-stealing
+//                  thread pool
+enum class path_engine {
+    reference,
+    fourrussians,
+    doubling,
+    worklist,
+    datalog,
+    cfl,
+    parallel
+};
+
+path_engine parse_engine(std::string_view name);
+
+// tuning for a single run of the algorithm.
+struct path_options {
+    path_engine engine = path_engine::reference;
+    // worker threads, for the engines that use them
+    unsigned nthreads = 1;
+    // pin those threads to NUMA nodes and have each first touch the rows it
+    // works on, so they are allocated on its node. nothing on one node.
+    bool numa = false;
+
+    // if set, the state of the run is written here every `checkpoint_every`
+    // and removed once the run completes. reference engine only.
+    std::string checkpoint;
+    std::chrono::seconds checkpoint_every{300};
+    // continue from `checkpoint` if it exists. a checkpoint taken from
+    // different input matrices is an error.
+    bool resume = false;
+    // called after every sweep
+    std::function<void(const sweep_stats&)> on_sweep;
+
+    // where the matrices the engine makes, the result among them, are
+    // allocated, such as a run_arena. the default resource if null.
+    std::pmr::memory_resource* memory = nullptr;
+
+    std::pmr::memory_resource* resource() const
+    {
+        return memory ? memory : std::pmr::get_default_resource();
+    }
+};
+
+adjmat exact0paths(adjmat& dm1, adjmat& d0, adjmat& d1,
+                   const path_options& opts = {});
 
 // takes a complete adjacency list instead of 3 separate ones
-adjmat exact0paths(const adjmat& mat);
+adjmat exact0paths(const adjmat& mat, const path_options& opts = {});
 
 // takes just an edge set
-adjmat exact0paths(const std::map<std::pair<int, int>, int>& edges);
+adjmat exact0paths(const edge_set& edges, const path_options& opts = {});
+
+// runs the algorithm only on the part of the graph reachable from `sources`.
+// rows of the result for those sources match the full result; vertices that
+// weren't reached are left out of it.
+adjmat exact0paths_from(const edge_set& edges, const std::set<int>& sources,
+                        const path_options& opts = {});
 
 #endif
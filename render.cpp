@@ -0,0 +1,216 @@
+#include "render.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// flush once the buffer passes this many bytes.
+static constexpr size_t flush_bytes = 1 << 16;
+
+static void render_serial(std::ostream& os, size_t nrows, const row_fn& fn)
+{
+    std::string buf;
+    buf.reserve(2 * flush_bytes);
+    for (size_t r = 0; r < nrows; ++r) {
+        fn(buf, r, r + 1);
+        if (buf.size() >= flush_bytes) {
+            os.write(buf.data(), buf.size());
+            buf.clear();
+        }
+    }
+    os.write(buf.data(), buf.size());
+}
+
+// workers format chunks of rows into a ring of buffers, which the caller
+// writes out in row order as they complete, formatting chunks itself in
+// between. each chunk is sized from the bytes per row seen so far to come to
+// about flush_bytes, starting from a single row and at most doubling, so
+// short or empty rows early on don't make one chunk swallow the table.
+static void render_parallel(std::ostream& os, size_t nrows, const row_fn& fn,
+                            unsigned nthreads)
+{
+    struct slot {
+        std::string buf;
+        bool done = false;
+    };
+    std::vector<slot> ring(2 * nthreads);
+    std::mutex lock;
+    std::condition_variable changed;
+    // rows handed out, chunks handed out, and chunks written
+    size_t next_row = 0, claimed = 0, written = 0;
+    // what the formatted chunks came to
+    size_t rows_done = 0, bytes_done = 0;
+
+    auto can_claim = [&] {
+        return next_row < nrows && claimed < written + ring.size();
+    };
+    // claims and formats the next chunk. called with `held` locked; it is
+    // unlocked while formatting.
+    auto format = [&](std::unique_lock<std::mutex>& held) {
+        size_t rows = std::max<size_t>(rows_done, 1);
+        if (bytes_done) {
+            rows = std::min(rows, std::max<size_t>(
+                                      flush_bytes * rows_done / bytes_done, 1));
+        }
+        // leave every worker a share of the last rows
+        rows = std::min(rows, (nrows - next_row + nthreads - 1) / nthreads);
+
+        size_t r0 = next_row, r1 = r0 + rows;
+        slot& s = ring[claimed++ % ring.size()];
+        next_row = r1;
+        s.buf.clear();
+        held.unlock();
+        fn(s.buf, r0, r1);
+        held.lock();
+        s.done = true;
+        rows_done += r1 - r0;
+        bytes_done += s.buf.size();
+        changed.notify_all();
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(nthreads - 1);
+    for (unsigned t = 1; t < nthreads; ++t) {
+        workers.emplace_back([&] {
+            std::unique_lock held(lock);
+            for (;;) {
+                changed.wait(held,
+                             [&] { return can_claim() || next_row == nrows; });
+                if (!can_claim()) {
+                    return; // every row is taken
+                }
+                format(held);
+            }
+        });
+    }
+
+    std::string out;
+    std::unique_lock held(lock);
+    while (written < claimed || next_row < nrows) {
+        slot& s = ring[written % ring.size()];
+        if (s.done) {
+            // hand the slot back before writing, so workers can go on
+            out.swap(s.buf);
+            s.done = false;
+            ++written;
+            changed.notify_all();
+            held.unlock();
+            os.write(out.data(), out.size());
+            held.lock();
+        }
+        else if (can_claim()) {
+            format(held);
+        }
+        else {
+            changed.wait(held);
+        }
+    }
+    held.unlock();
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+void render_rows(std::ostream& os, size_t nrows, const row_fn& fn,
+                 unsigned nthreads)
+{
+    if (nthreads <= 1 || nrows < 2) {
+        render_serial(os, nrows, fn);
+    }
+    else {
+        render_parallel(os, nrows, fn, nthreads);
+    }
+}
+
+void append_int(std::string& buf, int val, size_t wide)
+{
+    char digits[16];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), val);
+    size_t len = end - digits;
+    if (len < wide) {
+        buf.append(wide - len, ' ');
+    }
+    buf.append(digits, len);
+}
+
+#ifdef TESTING
+#include "doctest.h"
+
+#include <atomic>
+#include <sstream>
+
+TEST_CASE("render_rows")
+{
+    // long enough rows that threaded rendering takes several waves
+    std::string big(5000, 'x');
+    std::ostringstream out;
+    render_rows(out, 200, [&](std::string& buf, size_t r0, size_t r1) {
+        for (auto r = r0; r < r1; ++r) {
+            append_int(buf, r, 4);
+            buf += big;
+        }
+    });
+
+    std::string expect;
+    for (int r = 0; r < 200; ++r) {
+        expect += std::string(4 - std::to_string(r).size(), ' ') +
+                  std::to_string(r) + big;
+    }
+    CHECK(out.str() == expect);
+
+    for (unsigned nthreads : {2u, 3u, 8u}) {
+        std::ostringstream par;
+        render_rows(
+            par, 200,
+            [&](std::string& buf, size_t r0, size_t r1) {
+                for (auto r = r0; r < r1; ++r) {
+                    append_int(buf, r, 4);
+                    buf += big;
+                }
+            },
+            nthreads);
+        CHECK(par.str() == expect);
+    }
+
+    SUBCASE("short first rows")
+    {
+        // a hundred empty rows, then 100 byte ones. no chunk may take more
+        // than a few flushes' worth.
+        auto row = [](std::string& buf, size_t r) {
+            if (r >= 100) {
+                append_int(buf, r, 100);
+            }
+        };
+        std::string serial;
+        for (size_t r = 0; r < 20000; ++r) {
+            row(serial, r);
+        }
+        for (unsigned nthreads : {2u, 4u}) {
+            std::atomic<size_t> largest{0};
+            std::ostringstream par;
+            render_rows(
+                par, 20000,
+                [&](std::string& buf, size_t r0, size_t r1) {
+                    for (auto r = r0; r < r1; ++r) {
+                        row(buf, r);
+                    }
+                    size_t had = largest;
+                    while (buf.size() > had &&
+                           !largest.compare_exchange_weak(had, buf.size())) {
+                    }
+                },
+                nthreads);
+            CHECK(par.str() == serial);
+            CHECK(largest <= 4 * flush_bytes);
+        }
+    }
+
+    std::string s;
+    append_int(s, -12, 2);
+    CHECK(s == "-12");
+}
+
+#endif
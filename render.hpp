@@ -0,0 +1,24 @@
+#ifndef RENDER_HPP
+#define RENDER_HPP
+
+#include <string>
+#include <iostream>
+#include <functional>
+
+// appends the formatted rows [r0, r1) to the buffer.
+using row_fn = std::function<void(std::string&, size_t, size_t)>;
+
+// formats rows [0, nrows) into a reusable buffer with `fn` and writes it to
+// `os` in large blocks instead of one small formatted write per cell.
+//
+// with nthreads > 1, chunks of rows of about one flush each are formatted
+// into separate buffers by worker threads, started once per call, and written
+// out in row order. `fn` must then be safe to call concurrently on disjoint
+// ranges.
+void render_rows(std::ostream& os, size_t nrows, const row_fn& fn,
+                 unsigned nthreads = 1);
+
+// appends `val` right-aligned in a field of `wide` bytes, like std::setw.
+void append_int(std::string& buf, int val, size_t wide);
+
+#endif
@@ -0,0 +1,279 @@
+#include "scheduler.hpp"
+#include "numa.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+// a worker's tasks. each sits on its own cache line so workers popping their
+// own deques don't contend.
+struct alignas(64) steal_pool::task_deque {
+    std::mutex lock;
+    std::deque<size_t> tasks;
+
+    std::optional<size_t> pop_front()
+    {
+        std::lock_guard guard(lock);
+        if (tasks.empty()) {
+            return std::nullopt;
+        }
+        size_t t = tasks.front();
+        tasks.pop_front();
+        return t;
+    }
+
+    std::optional<size_t> pop_back()
+    {
+        std::lock_guard guard(lock);
+        if (tasks.empty()) {
+            return std::nullopt;
+        }
+        size_t t = tasks.back();
+        tasks.pop_back();
+        return t;
+    }
+};
+
+steal_pool::steal_pool(unsigned nthreads, bool numa)
+    : _nthreads{std::max(nthreads, 1u)}, _deques(_nthreads),
+      _stats(_nthreads)
+{
+    std::vector<std::vector<int>> nodes;
+    if (numa) {
+        nodes = numa_nodes();
+        _pinned = nodes.size() > 1;
+    }
+    // worker w's CPUs, or none to leave it be
+    auto cpus = [&](unsigned w) {
+        return _pinned ? nodes[size_t(w) * nodes.size() / _nthreads]
+                       : std::vector<int>{};
+    };
+
+    if (_pinned) {
+        _caller_cpus = thread_cpus();
+        pin_thread(cpus(0));
+    }
+    _threads.reserve(_nthreads - 1);
+    for (unsigned w = 1; w < _nthreads; ++w) {
+        _threads.emplace_back(&steal_pool::serve, this, w, cpus(w));
+    }
+}
+
+// the _batch value that tells workers to exit
+static constexpr uint64_t closing = ~uint64_t(0);
+
+steal_pool::~steal_pool()
+{
+    _batch.store(closing, std::memory_order_release);
+    _batch.notify_all();
+    for (auto& t : _threads) {
+        t.join();
+    }
+    if (_pinned) {
+        pin_thread(_caller_cpus);
+    }
+}
+
+void steal_pool::work(unsigned self)
+{
+    using clock = std::chrono::steady_clock;
+    worker_stats& mine = _stats[self];
+    if (_each) {
+        auto start = clock::now();
+        (*_each)(self);
+        mine.busy += clock::now() - start;
+        ++mine.tasks;
+        return;
+    }
+    auto run = [&](size_t t) {
+        auto start = clock::now();
+        (*_task)(t, self);
+        mine.busy += clock::now() - start;
+        ++mine.tasks;
+    };
+    while (auto t = _deques[self].pop_front()) {
+        run(*t);
+    }
+    // nothing is ever added mid-batch, so once every deque has been found
+    // empty there is nothing left to steal.
+    for (unsigned i = 1; i < _nthreads; ++i) {
+        task_deque& victim = _deques[(self + i) % _nthreads];
+        while (auto t = victim.pop_back()) {
+            ++mine.stolen;
+            run(*t);
+        }
+    }
+}
+
+void steal_pool::serve(unsigned self, std::vector<int> cpus)
+{
+    if (!cpus.empty()) {
+        pin_thread(cpus);
+    }
+    uint64_t seen = 0;
+    for (;;) {
+        _batch.wait(seen, std::memory_order_acquire);
+        seen = _batch.load(std::memory_order_acquire);
+        if (seen == closing) {
+            return;
+        }
+        work(self);
+        // the last one out wakes the caller
+        if (_busy.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            _busy.notify_one();
+        }
+    }
+}
+
+std::vector<worker_stats>
+steal_pool::run(size_t ntasks,
+                const std::function<void(size_t, unsigned)>& task,
+                const std::function<unsigned(size_t)>& owner)
+{
+    if (owner) {
+        for (size_t t = 0; t < ntasks; ++t) {
+            _deques[owner(t) % _nthreads].tasks.push_back(t);
+        }
+    }
+    else {
+        for (unsigned w = 0; w < _nthreads; ++w) {
+            for (size_t t = ntasks * w / _nthreads;
+                 t < ntasks * (w + 1) / _nthreads; ++t) {
+                _deques[w].tasks.push_back(t);
+            }
+        }
+    }
+    _task = &task;
+    _each = nullptr;
+    dispatch();
+    return _stats;
+}
+
+void steal_pool::each(const std::function<void(unsigned)>& fn)
+{
+    _each = &fn;
+    dispatch();
+    _each = nullptr;
+}
+
+void steal_pool::dispatch()
+{
+    for (auto& s : _stats) {
+        s = {};
+    }
+    _busy.store(_nthreads - 1, std::memory_order_relaxed);
+    // publishes the deques, _task and _each along with the new batch
+    _batch.fetch_add(1, std::memory_order_release);
+    _batch.notify_all();
+
+    work(0);
+    for (unsigned busy; (busy = _busy.load(std::memory_order_acquire));) {
+        _busy.wait(busy, std::memory_order_acquire);
+    }
+}
+
+#ifdef TESTING
+#include "doctest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <latch>
+
+TEST_CASE("steal_pool")
+{
+    for (unsigned nthreads : {1u, 2u, 5u}) {
+        steal_pool pool(nthreads);
+        CHECK(pool.size() == nthreads);
+        // the same threads take batch after batch
+        for (size_t ntasks : {37, 0, 4}) {
+            std::vector<std::atomic<int>> runs(ntasks);
+            auto stats = pool.run(ntasks, [&](size_t t, unsigned worker) {
+                CHECK(worker < nthreads);
+                ++runs[t];
+            });
+            CHECK(stats.size() == nthreads);
+            size_t total = 0;
+            for (const auto& s : stats) {
+                total += s.tasks;
+                CHECK(s.stolen <= s.tasks);
+            }
+            CHECK(total == ntasks);
+            for (const auto& r : runs) {
+                CHECK(r == 1);
+            }
+        }
+    }
+
+    SUBCASE("owner and each")
+    {
+        steal_pool pool(3, true);
+        std::vector<unsigned> ran(3, 9);
+        pool.each([&](unsigned worker) { ran[worker] = worker; });
+        CHECK(ran == std::vector<unsigned>{0, 1, 2});
+
+        // every task dealt to worker 1, which is held in each task it runs
+        // until another worker has run one of them, so some must be stolen
+        std::latch stolen(1);
+        std::atomic<bool> opened{false};
+        std::vector<unsigned> ran_on(12, 9);
+        auto stats = pool.run(
+            12,
+            [&](size_t t, unsigned worker) {
+                ran_on[t] = worker;
+                if (worker == 1) {
+                    stolen.wait();
+                }
+                else if (!opened.exchange(true)) {
+                    stolen.count_down();
+                }
+            },
+            [](size_t) { return 1u; });
+        CHECK(std::ranges::any_of(ran_on, [](unsigned w) { return w != 1; }));
+        CHECK(std::ranges::none_of(ran_on, [](unsigned w) { return w > 2; }));
+        size_t total = 0;
+        for (unsigned w = 0; w < 3; ++w) {
+            total += stats[w].tasks;
+            // tasks run anywhere but their owner are exactly the stolen ones
+            CHECK(stats[w].stolen == (w == 1 ? 0 : stats[w].tasks));
+        }
+        CHECK(total == 12);
+        CHECK(stats[1].tasks < 12);
+    }
+
+    SUBCASE("epoch_counter")
+    {
+        steal_pool pool(3);
+        epoch_counter changed(pool.size());
+        for (uint64_t epoch = 1; epoch <= 3; ++epoch) {
+            // in the third sweep nothing changes
+            pool.run(30, [&](size_t t, unsigned worker) {
+                if (epoch < 3) {
+                    changed.add(worker, epoch, t);
+                }
+            });
+            CHECK(changed.total(epoch) == (epoch < 3 ? 435 : 0));
+        }
+    }
+
+    SUBCASE("stealing")
+    {
+        // worker 0's first task holds it up until the other has taken the
+        // rest of its deque
+        steal_pool pool(2);
+        std::atomic<size_t> done{0};
+        auto stats = pool.run(8, [&](size_t t, unsigned) {
+            if (t == 0) {
+                while (done < 7) {
+                    std::this_thread::yield();
+                }
+            }
+            ++done;
+        });
+        CHECK(stats[0].tasks == 1);
+        CHECK(stats[1].tasks == 7);
+        CHECK(stats[1].stolen == 3);
+    }
+}
+
+#endif
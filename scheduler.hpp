@@ -0,0 +1,128 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// what one worker did during a run
+struct worker_stats {
+    size_t tasks = 0;  // tasks run, stolen ones included
+    size_t stolen = 0; // tasks taken from another worker's deque
+    std::chrono::duration<double> busy{0};
+};
+
+// a fixed set of worker threads, the caller's among them, running batches of
+// tasks by work stealing.
+//
+// each worker starts a batch with a contiguous run of the tasks in its own
+// deque and works through it from the front. a worker whose deque is empty
+// steals from the back of another's, so workers whose tasks turn out cheap
+// take over from those whose tasks don't. tasks can't add tasks.
+//
+// with `numa` set on a machine with more than one node, workers are pinned
+// to nodes, spread evenly in worker order, so memory a worker first touches
+// in each() lands on its own node. on a single node `numa` does nothing.
+//
+// the threads live as long as the pool, so an engine that runs thousands of
+// short sweeps doesn't start thousands of threads. starting a batch and
+// waiting for it to finish are atomic counters that threads wait on, with no
+// lock taken; a batch's end is a barrier every worker's writes happen
+// before.
+class steal_pool {
+public:
+    explicit steal_pool(unsigned nthreads, bool numa = false);
+    ~steal_pool();
+
+    steal_pool(const steal_pool&) = delete;
+    steal_pool& operator=(const steal_pool&) = delete;
+
+    unsigned size() const { return _nthreads; }
+    // whether workers were pinned to NUMA nodes
+    bool pinned() const { return _pinned; }
+
+    // runs task(i, worker) for every i in [0, ntasks) and returns once all
+    // are done. `owner`, if given, picks the worker whose deque each task
+    // starts in; otherwise each worker starts with a contiguous run.
+    std::vector<worker_stats>
+    run(size_t ntasks, const std::function<void(size_t, unsigned)>& task,
+        const std::function<unsigned(size_t)>& owner = {});
+
+    // runs fn(worker) once on every worker, itself and no other
+    void each(const std::function<void(unsigned)>& fn);
+
+private:
+    struct task_deque;
+
+    // runs worker `self`'s share of the current batch
+    void work(unsigned self);
+    // the body of each thread but the caller's
+    void serve(unsigned self, std::vector<int> cpus);
+    // starts the current batch on the other workers, runs the caller's
+    // part, and waits for the rest
+    void dispatch();
+
+    unsigned _nthreads;
+    bool _pinned = false;
+    // the caller's CPUs before it was pinned
+    std::vector<int> _caller_cpus;
+    std::vector<task_deque> _deques;
+    std::vector<worker_stats> _stats;
+    const std::function<void(size_t, unsigned)>* _task = nullptr;
+    const std::function<void(unsigned)>* _each = nullptr;
+
+    // batches started; bumped to wake the workers. ~0 closes the pool.
+    std::atomic<uint64_t> _batch{0};
+    // threads still on the current batch, the caller's aside
+    std::atomic<unsigned> _busy{0};
+
+    std::vector<std::thread> _threads;
+};
+
+// per-sweep counters for pool workers, e.g. of cells changed, without a
+// shared flag: each worker adds to a slot on its own cache line, stamped with
+// the sweep (epoch) it counts for, so nothing is reset between sweeps and no
+// two workers write the same line. read the total after the barrier.
+class epoch_counter {
+public:
+    explicit epoch_counter(unsigned nworkers) : _slots(nworkers){};
+
+    // called by `worker` only, during sweep `epoch`
+    void add(unsigned worker, uint64_t epoch, uint64_t n)
+    {
+        slot& s = _slots[worker];
+        uint64_t had = 0;
+        if (s.epoch.load(std::memory_order_relaxed) == epoch) {
+            had = s.count.load(std::memory_order_relaxed);
+        }
+        else {
+            s.epoch.store(epoch, std::memory_order_relaxed);
+        }
+        s.count.store(had + n, std::memory_order_relaxed);
+    }
+
+    // the sum over workers for `epoch`
+    uint64_t total(uint64_t epoch) const
+    {
+        uint64_t sum = 0;
+        for (const auto& s : _slots) {
+            if (s.epoch.load(std::memory_order_relaxed) == epoch) {
+                sum += s.count.load(std::memory_order_relaxed);
+            }
+        }
+        return sum;
+    }
+
+private:
+    struct alignas(64) slot {
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<uint64_t> count{0};
+    };
+    std::vector<slot> _slots;
+};
+
+#endif